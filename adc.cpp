@@ -25,9 +25,12 @@
 
 #include <stdlib.h>                         // Include standard library header files
 #include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
 
 #include "rs232int.h"                       // Include header for serial port class
 #include "adc.h"                            // Include header for the A/D class
+#include "square_root.h"                    // Integer square root, for lock-in amplitudes
 
 
 //-------------------------------------------------------------------------------------
@@ -35,7 +38,11 @@
  *  \details The A/D is made ready so that when a method such as @c read_once() is 
  *  called, correct A/D conversions can be performed. The ADC Control and Status
  *  Register is set such that the reference voltage source is from AVCC with external
- *  Capacitor at AREF pin and the clock prescaler is at a division factor of 32. 
+ *  Capacitor at AREF pin and the clock prescaler is at a division factor of 128, 
+ *  which keeps the A/D clock at 125 kHz, inside the 50 to 200 kHz range needed for
+ *  full resolution. A conversion then takes 104 us, so a scan doesn't interrupt the
+ *  processor too often. The queues for conversion requests are made here, so the
+ *  object should be made in main() before the scheduler starts.
  *  @param p_serial_port A pointer to the serial port which writes debugging info. 
  */
 
@@ -43,9 +50,18 @@ adc::adc (emstream* p_serial_port)
 {
 	ptr_to_serial = p_serial_port;
 
-	ADCSRA |= (1<<ADEN)|(1<<ADPS0)|(1<<ADPS2);
+	ADCSRA |= (1<<ADEN)|(1<<ADPS0)|(1<<ADPS1)|(1<<ADPS2);
 	ADMUX  |= (1<<REFS0);
 
+	for (uint8_t priority = 0; priority < ADC_PRIORITIES; priority++)
+	{
+		if (server.queues[priority] == NULL)
+		{
+			server.queues[priority] = xQueueCreate (ADC_QUEUE_SIZE, 
+													sizeof (adc_request_t));
+		}
+	}
+
 	// Print a handy debugging message
 	DBG (ptr_to_serial, "A/D constructor OK" << endl);
 }
@@ -53,78 +69,78 @@ adc::adc (emstream* p_serial_port)
 
 //-------------------------------------------------------------------------------------
 /** @brief   This method takes one A/D reading from the given channel and returns it. 
- *  @details This function performs a single A/D conversion based on the paramenter ch. The
- * 			 selected channel input is read and the ADMUX and ADCSRA registers are set
- * 			 accordingly. The A/D conversion is initiated and the code waits until
- * 			 the ADSC bit returns to 0, signifying the conversion is complete. Finally,
- * 			 the A/D conversion result is stored and the value returned.
+ *  @details This function performs a single A/D conversion based on the paramenter ch.
+ * 			 The multiplexer bits of ADMUX are set straight from the channel number,
+ * 			 the conversion is started, and the code waits until the ADSC bit returns
+ * 			 to 0, signifying the conversion is complete. The result is read as one
+ * 			 16-bit register, which reads the low byte first as the A/D requires.
  *  @param   ch The A/D channel which is being read must be from 0 to 7
+ *           It must not be used while a scan is running or requests are being served.
  *  @return  The result of the A/D conversion
  */
 
 uint16_t adc::read_once (uint8_t ch)
 {
-	uint16_t result;
-		
-	// Set channels depending on input parameter ch
-	switch (ch) 
-	{
-	  case 0:
-	    ADMUX  &= ~(1<<MUX4)& ~(1<<MUX3)& ~(1<<MUX2)& ~(1<<MUX1)& ~(1<<MUX0);
-	    ADCSRA |= (1<<ADSC);
-	    break;
-	  
-	  case 1:
-	    ADMUX  &= ~(1<<MUX4)& ~(1<<MUX3)& ~(1<<MUX2)& ~(1<<MUX1);
-	    ADMUX  |= (1<<MUX0);
-	    ADCSRA |= (1<<ADSC);
-	    break;
-	    
-	  case 2:
-	    ADMUX  &= ~(1<<MUX4)& ~(1<<MUX3)& ~(1<<MUX2)& ~(1<<MUX0);
-	    ADMUX  |= (1<<MUX1);
-	    ADCSRA |= (1<<ADSC);
-	    break;
-	    
-	  case 3:
-	    ADMUX  &= ~(1<<MUX4)& ~(1<<MUX3)& ~(1<<MUX2);
-	    ADMUX  |= (1<<MUX1)|(1<<MUX0);
-	    ADCSRA |= (1<<ADSC);
-	    break;
-	    
-	  case 4:
-	    ADMUX  &= ~(1<<MUX4)& ~(1<<MUX3)& ~(1<<MUX1)& ~(1<<MUX0);
-	    ADMUX  |= (1<<MUX2);
-	    ADCSRA |= (1<<ADSC);
-	    break;
-	    
-	  case 5:
-	    ADMUX  &= ~(1<<MUX4)& ~(1<<MUX3)& ~(1<<MUX1);
-	    ADMUX  |= (1<<MUX2)|(1<<MUX0);
-	    ADCSRA |= (1<<ADSC);
-	    break;
-	    
-	  case 6:
-	    ADMUX  &= ~(1<<MUX4)& ~(1<<MUX3)& ~(1<<MUX0);
-	    ADMUX  |= (1<<MUX2)|(1<<MUX1);
-	    ADCSRA |= (1<<ADSC);
-	    break;
-	    
-	  case 7:
-	    ADMUX  &= ~(1<<MUX4)& ~(1<<MUX3);
-	    ADMUX  |= (1<<MUX2)|(1<<MUX1)|(1<<MUX0);
-	    ADCSRA |= (1<<ADSC);
-	    break;
-	    
-	  default :
-	    break;
-	}
+	select (ch);
+	ADCSRA |= (1<<ADSC);
 
 	while(ADCSRA & (1<<ADSC))
 	{}
 
- 	result = (ADCL | (ADCH<<8));
-	return (result);
+	return (ADC);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   This method reads several channels, interleaving their conversions.
+ *  @details Each pass converts every channel in the mask once, lowest channel first,
+ *           and the passes are repeated @c samples times. Compared with reading each
+ *           channel's samples one after another, all the channels' averages then 
+ *           cover the same stretch of time, so comparing them isn't skewed by a 
+ *           signal which changes during the reading. Like @c read_once() this waits 
+ *           for each conversion, so it can't be used while a scan is running.
+ *  @param   mask A bit mask of the channels to read; bit 0 is channel 0 and so on
+ *  @param   readings An array which gets the average for each channel in the mask,
+ *           in order of channel number; it needs one element for each bit set
+ *  @param   samples The number of conversions of each channel to average, from 1 to
+ *           @c ADC_SCAN_SAMPLES
+ */
+
+void adc::read_channels (uint8_t mask, uint16_t* readings, uint8_t samples)
+{
+	uint16_t sums[ADC_SCAN_MAX];
+	uint8_t  count = 0;
+
+	if (samples > ADC_SCAN_SAMPLES)
+	{
+		samples = ADC_SCAN_SAMPLES;
+	}
+	else if (samples == 0)
+	{
+		samples = 1;
+	}
+
+	for (uint8_t index = 0; index < ADC_SCAN_MAX; index++)
+	{
+		sums[index] = 0;
+	}
+
+	for (uint8_t pass = 0; pass < samples; pass++)
+	{
+		count = 0;
+		for (uint8_t channel = 0; channel < 8; channel++)
+		{
+			if (mask & (1 << channel))
+			{
+				sums[count++] += read_once (channel);
+			}
+		}
+	}
+
+	for (uint8_t index = 0; index < count; index++)
+	{
+		readings[index] = sums[index] / samples;
+	}
 }
 
 
@@ -133,39 +149,594 @@ uint16_t adc::read_once (uint8_t ch)
  *  \details This function takes a set number of samples from the read_once function and averages them
  *			together to reduce the effects of noise.  
  *  @param   channel The A/D channel which is being read must be from 0 to 7.
- *  @param   samples Number of samples to be averaged.
+ *  @param   samples Number of samples to be averaged, from 1 to @c ADC_SCAN_SAMPLES
  *  @return  The result of the averaged A/D conversion
  */
 
 uint16_t adc::read_oversampled (uint8_t channel, uint8_t samples)
 {
-	uint8_t  count;
-	uint16_t sum;
-	uint16_t average;
-	uint16_t result;
+	uint16_t sum = 0;
 	
-	average = 0;
-	count = 0;
-	sum = 0;
+	if (samples > ADC_SCAN_SAMPLES)
+	{
+		samples = ADC_SCAN_SAMPLES;
+	}
+	else if (samples == 0)
+	{
+		samples = 1;
+	}
 	
-	if (samples > 10)
+	for (uint8_t count = 0; count < samples; count++)
 	{
-	  samples = 10;
+		sum += read_once (channel);
 	}
+
+	return (sum / samples);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   This method oversamples a channel and decimates the sum to get more bits
+ *           of resolution than the A/D has.
+ *  @details For each extra bit, four times as many conversions are added up and the
+ *           sum is shifted right by one bit instead of being divided by the number of
+ *           conversions, leaving the extra bits below the A/D's own 10 bits. This only
+ *           works if the signal has at least a count or so of noise on it, which the
+ *           phototransistors do; a perfectly steady input would only give zeros in the
+ *           extra bits. Since the number of conversions is a power of two, no division
+ *           is needed.
+ *  @param   channel The A/D channel which is being read, from 0 to 7
+ *  @param   extra_bits The number of bits to add, from 0 to @c ADC_EXTRA_BITS_MAX; 
+ *           3 bits takes 64 conversions
+ *  @return  The reading, from 0 to 1023 shifted left by @c extra_bits
+ */
+
+uint16_t adc::read_decimated (uint8_t channel, uint8_t extra_bits)
+{
+	uint16_t sum = 0;
+
+	if (extra_bits > ADC_EXTRA_BITS_MAX)
+	{
+		extra_bits = ADC_EXTRA_BITS_MAX;
+	}
+
+	uint8_t samples = 1 << (2 * extra_bits);
+	for (uint8_t count = 0; count < samples; count++)
+	{
+		sum += read_once (channel);
+	}
+
+	return (sum >> extra_bits);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** The scan state block, which belongs to the A/D converter's ISR.
+ */
+
+adc_scan_t adc::scan;
+
+/** The request queues and the request being served, which belong to the A/D 
+ *  converter's ISR once the queues are made.
+ */
+
+adc_server_t adc::server;
+
+/// The timer 0 compare value which starts conversions at @c ADC_TRIGGER_HZ
+#define ADC_TRIGGER_TOP  (F_CPU / 64 / ADC_TRIGGER_HZ - 1)
+
+static_assert (ADC_TRIGGER_TOP <= 255 && ADC_TRIGGER_HZ <= 8000, 
+			   "ADC_TRIGGER_HZ must be from 1000 to 8000 Hz");
+
+
+#ifdef ADC_AUTORANGE
+//-------------------------------------------------------------------------------------
+/** This function puts a sum of conversions made with either reference onto the scale
+ *  of the AVCC reference with @c ADC_RANGE_BITS extra bits, so readings made with 
+ *  different references can be compared. Readings made with the internal reference
+ *  fill fewer counts of that scale, but they have twice the resolution.
+ *  @param   sum The sum of the conversions
+ *  @param   samples The number of conversions in the sum
+ *  @param   internal Nonzero if the conversions were made with the internal reference
+ *  @return  The average, on the AVCC scale times 2^ADC_RANGE_BITS
+ */
+
+static uint16_t normalize (uint32_t sum, uint8_t samples, uint8_t internal)
+{
+	if (internal)
+	{
+		return ((sum * ((uint32_t)ADC_INTERNAL_MV << ADC_RANGE_BITS)) 
+				/ ((uint32_t)ADC_AVCC_MV * samples));
+	}
+	return ((sum << ADC_RANGE_BITS) / samples);
+}
+#endif // ADC_AUTORANGE
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   This method sets the A/D multiplexer to a single-ended channel.
+ *  @details The reference selection bits in ADMUX are kept as they are, and the other
+ *           channel bits are cleared.
+ *  @param   channel The A/D channel, from 0 to 7
+ */
+
+void adc::select (uint8_t channel)
+{
+	ADMUX = (ADMUX & ((1 << REFS1) | (1 << REFS0))) | (channel & 0x07);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   This method starts the A/D converter scanning a list of channels.
+ *  @details Timer 0 runs in CTC mode at @c ADC_TRIGGER_HZ and its compare match 
+ *           starts each conversion, so the samples are evenly spaced in time. The 
+ *           conversion complete interrupt adds each result to its channel's sum and 
+ *           sets the multiplexer for the next conversion. The channels are taken in
+ *           turn, so each pass is a boxcar average of @c samples conversions of every
+ *           channel spread over the same time, which also decimates the sample rate by
+ *           @c samples. Nothing waits in a loop. Since the ISR owns the converter, 
+ *           @c read_once() and @c read_oversampled() mustn't be used until 
+ *           @c stop_scan() is called; other tasks must use @c request() instead.
+ *           Each request takes the place of one or more of the scan's conversions,
+ *           which only delays the scan a little; with @c -DADC_LOCKIN it shifts the
+ *           beacon's phase in the following conversions, though, so requests should
+ *           be rare while demodulating. With @c -DADC_AUTORANGE the scan starts on 
+ *           whichever reference is in use and switches between AVCC and the internal
+ *           reference as its signals grow and shrink; see @c add_to_scan().
+ *  @param   channels An array of the channels to be scanned, in order
+ *  @param   count The number of channels in the array, up to @c ADC_SCAN_MAX
+ *  @param   samples How many conversions of each channel are added up in each pass
+ *           of the scan, from 1 to @c ADC_SCAN_SAMPLES
+ */
+
+void adc::start_scan (const uint8_t* channels, uint8_t count, uint8_t samples)
+{
+	if (count > ADC_SCAN_MAX)
+	{
+		count = ADC_SCAN_MAX;
+	}
+	#ifdef ADC_LOCKIN
+		// Each pass must cover whole cycles of the beacon, four conversions each
+		if (samples > ADC_LOCKIN_SAMPLES)
+		{
+			samples = ADC_LOCKIN_SAMPLES;
+		}
+		samples &= ~0x03;
+		if (samples == 0)
+		{
+			samples = 4;
+		}
+	#else
+		if (samples > ADC_SCAN_SAMPLES)
+		{
+			samples = ADC_SCAN_SAMPLES;
+		}
+		else if (samples == 0)
+		{
+			samples = 1;
+		}
+	#endif
+	
+	// Wait for any conversion that's still going, then set up the scan from scratch
+	stop_scan ();
+	while (ADCSRA & (1 << ADSC))
+	{}
 	
-	while (count <= samples)
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+	{
+		for (uint8_t index = 0; index < count; index++)
+		{
+			scan.channels[index] = channels[index];
+			scan.sums[0][index] = 0;
+			scan.sums[1][index] = 0;
+			#ifdef ADC_LOCKIN
+				scan.quadrature[0][index] = 0;
+				scan.quadrature[1][index] = 0;
+			#endif
+		}
+		scan.count = count;
+		scan.samples = samples;
+		scan.index = 0;
+		scan.taken = 0;
+		scan.fill = 0;
+		scan.ready = 1;
+		scan.passes = 0;
+		#ifdef ADC_AUTORANGE
+			scan.peak = 0;
+			scan.settle = 0;
+			scan.internal = (ADMUX & (1 << REFS1)) ? 1 : 0;
+			scan.ranges[0] = scan.internal;
+			scan.ranges[1] = scan.internal;
+		#endif
+		
+		select (scan.channels[0]);
+		
+		// Timer 0 counts at F_CPU / 64 and clears on compare match A
+		TCCR0A = (1 << WGM01);
+		TCCR0B = (1 << CS01) | (1 << CS00);
+		OCR0A = ADC_TRIGGER_TOP;
+		TIFR0 = (1 << OCF0A);
+		
+		// Timer 0 compare match A is the A/D's auto trigger source
+		ADCSRB = (ADCSRB & ~((1 << ADTS2) | (1 << ADTS1) | (1 << ADTS0)))
+				 | (1 << ADTS1) | (1 << ADTS0);
+		ADCSRA |= (1 << ADIF);
+		ADCSRA |= (1 << ADIE) | (1 << ADATE);
+	}
+
+	DBG (ptr_to_serial, "A/D scan of " << count << " channels started" << endl);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   This method stops the scan.
+ *  @details The conversion which is running, if any, finishes, but timer 0 doesn't
+ *           start another one. The interrupt is turned off unless a request is being
+ *           served, in which case the ISR turns it off when the requests run out.
+ */
+
+void adc::stop_scan (void)
+{
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+	{
+		ADCSRA &= ~(1 << ADATE);
+		if (!server.busy)
+		{
+			ADCSRA &= ~(1 << ADIE);
+		}
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   This method queues a request for an A/D reading, to be made by the ISR.
+ *  @details High priority requests are all served before low priority ones, and each
+ *           priority is first come, first served. During a scan, a request is 
+ *           converted in the place of the scan's next conversions, at the scan's rate.
+ *           Otherwise each conversion starts as soon as the last one is done, and if
+ *           the converter was idle the request is started here. Either way the task
+ *           doesn't spin: it can wait on its semaphore, or go on with other work and 
+ *           check it later. Each task should have its own binary semaphore, made with
+ *           @c xSemaphoreCreateBinary(), so it can't be woken by another's reading.
+ *           With @c -DADC_AUTORANGE, a request is converted with the scan's reference
+ *           and put on the same 12-bit scale as the scan's readings; a channel above
+ *           2.56 V reads as about 2.56 V while the scan is on the internal reference.
+ *  @param   channel The A/D channel to be read, from 0 to 7
+ *  @param   samples The number of conversions to average, from 1 to 
+ *           @c ADC_SCAN_SAMPLES
+ *  @param   p_reading A pointer to where the average is put; it must stay valid 
+ *           until the semaphore has been given
+ *  @param   done The semaphore which the ISR gives when the reading is ready
+ *  @param   priority Which queue the request waits in (default: low priority)
+ *  @return  True if the request was queued, or false if its queue was full
+ */
+
+bool adc::request (uint8_t channel, uint8_t samples, uint16_t* p_reading,
+				   SemaphoreHandle_t done, adc_priority_t priority)
+{
+	adc_request_t request;
+
+	if (samples > ADC_SCAN_SAMPLES)
+	{
+		samples = ADC_SCAN_SAMPLES;
+	}
+	else if (samples == 0)
+	{
+		samples = 1;
+	}
+	request.channel = channel;
+	request.samples = samples;
+	request.p_reading = p_reading;
+	request.done = done;
+
+	if (xQueueSendToBack (server.queues[priority], &request, 0) != pdTRUE)
+	{
+		return (false);
+	}
+
+	// If the converter is idle, nothing will run the ISR, so the request is started
+	// here; a stale flag from a blocking read mustn't look like a finished conversion
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
 	{
-	result = adc::read_once(channel);
-	sum = (result + sum);
-	count ++;
+		if (!(ADCSRA & (1 << ADIE)))
+		{
+			next_request (NULL);
+			if (server.busy)
+			{
+				ADCSRA |= (1 << ADIF);
+				ADCSRA |= (1 << ADIE) | (1 << ADSC);
+			}
+		}
 	}
+	return (true);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   This method copies the averages from the newest complete pass of the scan.
+ *  @details The copy is made with interrupts off, so all the readings come from the
+ *           same pass. If no pass has been completed yet, nothing is copied.
+ *  @param   readings An array with room for one reading of each channel in the scan,
+ *           in the same order as the list given to @c start_scan(). 
+ *           When the driver is compiled with @c -DADC_LOCKIN, the readings are instead
+ *           the amplitudes of each channel's light flashing at the beacon frequency,
+ *           @c ADC_TRIGGER_HZ / (4 * count), found from its in-phase and quadrature
+ *           sums. Steady light such as sunlight doesn't show up in them at all, and
+ *           the phase of the beacon doesn't matter. With @c -DADC_AUTORANGE, the
+ *           readings are on the AVCC scale with @c ADC_RANGE_BITS extra bits, from 0
+ *           to 4092, whichever reference the pass was made with.
+ *  @param   p_time A pointer to a variable which gets the RTOS tick count when the 
+ *           pass was finished, or @c NULL if it isn't wanted
+ *  @return  The number of passes completed; if it hasn't changed since the last call,
+ *           the readings haven't changed either
+ */
+
+uint16_t adc::get_scan (uint16_t* readings, TickType_t* p_time)
+{
+	uint16_t sums[ADC_SCAN_MAX];
+	uint8_t  count;
+	uint8_t  samples;
+	uint16_t passes;
+	#ifdef ADC_LOCKIN
+		uint16_t quadrature[ADC_SCAN_MAX];
+	#endif
+	#ifdef ADC_AUTORANGE
+		uint8_t  internal;
+	#endif
+
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+	{
+		count = scan.count;
+		samples = scan.samples;
+		passes = scan.passes;
+		if (p_time)
+		{
+			*p_time = scan.finished;
+		}
+		#ifdef ADC_AUTORANGE
+			internal = scan.ranges[scan.ready];
+		#endif
+		for (uint8_t index = 0; index < count; index++)
+		{
+			sums[index] = scan.sums[scan.ready][index];
+			#ifdef ADC_LOCKIN
+				quadrature[index] = scan.quadrature[scan.ready][index];
+			#endif
+		}
+	}
+
+	if (passes)
+	{
+		for (uint8_t index = 0; index < count; index++)
+		{
+			#ifdef ADC_LOCKIN
+				// A sine of amplitude A gives sums of magnitude samples * A / 2
+				int32_t in_phase = (int16_t)sums[index];
+				int32_t in_quad = (int16_t)quadrature[index];
+				uint32_t total = 2 * (uint32_t)square_root (in_phase * in_phase 
+															+ in_quad * in_quad);
+			#else
+				uint32_t total = sums[index];
+			#endif
+			#ifdef ADC_AUTORANGE
+				readings[index] = normalize (total, samples, internal);
+			#else
+				readings[index] = total / samples;
+			#endif
+		}
+	}
+	return (passes);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   This method adds a finished conversion to the scan.
+ *  @details The result is added to the sum for the channel being converted and the
+ *           scan moves on to the next channel. After @c samples times through the 
+ *           list, the set of sums just filled is handed over as the newest complete
+ *           pass, and the other set is cleared and filled next.
+ *
+ *           With @c -DADC_AUTORANGE the reference can change between passes, so all
+ *           of a pass is made with one reference. If the largest conversion in the
+ *           pass was small enough on AVCC, the internal 2.56 V reference is used next
+ *           for twice the resolution; if it came close to clipping on the internal
+ *           reference, AVCC is used next. After a switch, @c ADC_RANGE_SETTLE 
+ *           conversions are thrown away while AREF settles, converting the first 
+ *           channel over again, and the pass after that is the first on the new 
+ *           reference.
+ */
+
+void adc::add_to_scan (void)
+{
+	uint8_t index = scan.index;
+	uint16_t reading = ADC;
+
+	#ifdef ADC_AUTORANGE
+		if (scan.settle)
+		{
+			scan.settle--;
+			return;
+		}
+		if (reading > scan.peak)
+		{
+			scan.peak = reading;
+		}
+	#endif
 
-	average = (sum/count);
-	count = 0;
+	#ifdef ADC_LOCKIN
+		// Each channel is converted four times per cycle of the beacon, so its
+		// conversions are multiplied by a cosine and a sine which step through 
+		// 1, 0, -1, 0 and 0, 1, 0, -1; steady light adds up to nothing
+		switch (scan.taken & 0x03)
+		{
+			case (0):
+				scan.sums[scan.fill][index] += reading;
+				break;
+			case (1):
+				scan.quadrature[scan.fill][index] += reading;
+				break;
+			case (2):
+				scan.sums[scan.fill][index] -= reading;
+				break;
+			default:
+				scan.quadrature[scan.fill][index] -= reading;
+				break;
+		}
+	#else
+		scan.sums[scan.fill][index] += reading;
+	#endif
+
+	if (++index >= scan.count)
+	{
+		index = 0;
+		if (++scan.taken >= scan.samples)
+		{
+			scan.taken = 0;
+			scan.ready = scan.fill;
+			scan.fill ^= 1;
+			scan.passes++;
+			scan.finished = xTaskGetTickCountFromISR ();
+			for (uint8_t channel = 0; channel < scan.count; channel++)
+			{
+				scan.sums[scan.fill][channel] = 0;
+				#ifdef ADC_LOCKIN
+					scan.quadrature[scan.fill][channel] = 0;
+				#endif
+			}
+			
+			#ifdef ADC_AUTORANGE
+				scan.ranges[scan.ready] = scan.internal;
+				if (scan.internal)
+				{
+					if (scan.peak >= ADC_RANGE_DOWN)
+					{
+						scan.internal = 0;
+						ADMUX = (ADMUX & ~(1 << REFS1)) | (1 << REFS0);
+						scan.settle = ADC_RANGE_SETTLE;
+					}
+				}
+				else if (scan.peak < ADC_RANGE_UP)
+				{
+					scan.internal = 1;
+					ADMUX |= (1 << REFS1) | (1 << REFS0);
+					scan.settle = ADC_RANGE_SETTLE;
+				}
+				scan.peak = 0;
+			#endif
+		}
+	}
+	scan.index = index;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   This method takes the next waiting request from the queues, if there is
+ *           one, high priority first.
+ *  @details It is run from the ISR, or with interrupts off when the converter is idle.
+ *  @param   p_woken A pointer to a flag which is set if taking a request woke a task 
+ *           of higher priority, or @c NULL if that can't happen
+ */
+
+void adc::next_request (BaseType_t* p_woken)
+{
+	for (int8_t priority = ADC_PRIORITIES - 1; priority >= 0; priority--)
+	{
+		if (xQueueReceiveFromISR (server.queues[priority], &server.request, p_woken)
+			== pdTRUE)
+		{
+			server.sum = 0;
+			server.taken = 0;
+			server.busy = 1;
+			select (server.request.channel);
+			return;
+		}
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   This method is run by the ISR each time a conversion is done.
+ *  @details The result belongs to the request being served, if there is one, and 
+ *           otherwise to the scan. When a request has all its conversions, the 
+ *           average is put where it asked and its semaphore is given. Waiting 
+ *           requests go ahead of the scan, and the multiplexer is set for whichever
+ *           comes next well before timer 0 starts the next conversion. Without a scan,
+ *           the next request's conversion is started at once, and when there are no
+ *           more the interrupt is turned off. The timer's compare flag is cleared 
+ *           here, as the A/D is only triggered when the flag goes from 0 to 1.
+ */
+
+void adc::isr (void)
+{
+	BaseType_t woken = pdFALSE;
+
+	TIFR0 = (1 << OCF0A);
 	
-	return (average);
+	if (server.busy)
+	{
+		server.sum += ADC;
+		if (++server.taken >= server.request.samples)
+		{
+			#ifdef ADC_AUTORANGE
+				*server.request.p_reading = normalize (server.sum, 
+					server.request.samples, (ADMUX & (1 << REFS1)) ? 1 : 0);
+			#else
+				*server.request.p_reading = server.sum / server.request.samples;
+			#endif
+			xSemaphoreGiveFromISR (server.request.done, &woken);
+			server.busy = 0;
+		}
+	}
+	else
+	{
+		add_to_scan ();
+	}
+
+	// While the scan's reference settles, requests wait too
+	bool settling = false;
+	#ifdef ADC_AUTORANGE
+		settling = scan.settle && (ADCSRA & (1 << ADATE));
+	#endif
+	if (!server.busy && !settling)
+	{
+		next_request (&woken);
+	}
+
+	if (server.busy)
+	{
+		if (!(ADCSRA & (1 << ADATE)))
+		{
+			ADCSRA |= (1 << ADSC);
+		}
+	}
+	else if (ADCSRA & (1 << ADATE))
+	{
+		select (scan.channels[scan.index]);
+	}
+	else
+	{
+		ADCSRA &= ~(1 << ADIE);
+	}
+
+	// If a task waiting for its reading outranks the one interrupted, switch to it
+	if (woken)
+	{
+		taskYIELD ();
+	}
 }
 
+
+//-------------------------------------------------------------------------------------
+/** This interrupt service routine runs when an A/D conversion is complete. It serves
+ *  the conversion requests and runs the scan, if one has been started.
+ */
+
+ISR (ADC_vect)
+{
+	adc::isr ();
+}
+
+
 //-------------------------------------------------------------------------------------
 /** \brief   This overloaded operator "prints the A/D converter." 
  *  \details This prints the A/D control registers ADCSRA and ADMUX as well as the 
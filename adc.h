@@ -1,14 +1,17 @@
 //======================================================================================
 /** @file adc.h
- *    This file contains a very simple A/D converter driver. The driver is hopefully
- *    thread safe in FreeRTOS due to the use of a mutex to prevent its use by multiple
- *    tasks at the same time. There is no protection from priority inversion, however,
- *    except for the priority elevation in the mutex.
+ *    This file contains a very simple A/D converter driver. The blocking reads have
+ *    no protection at all and must only be used by one task while nothing else is
+ *    using the converter. Several tasks can share it safely through requests, which
+ *    are queued by priority and converted by the A/D's interrupt service routine in
+ *    between the conversions of a scan; each task is told its reading is ready by its
+ *    own semaphore.
  *
  *  Revisions:
  *    @li 01-15-2008 JRR Original (somewhat useful) file
  *    @li 10-11-2012 JRR Less original, more useful file with FreeRTOS mutex added
  *    @li 10-12-2012 JRR There was a bug in the mutex code, and it has been fixed
+ *    @li 10-16-2026 The mutex, long gone, is replaced by queued conversion requests
  *
  *  License:
  *    This file is copyright 2012 by JR Ridgely and released under the Lesser GNU 
@@ -30,6 +33,9 @@
 #ifndef _AVR_ADC_H_
 #define _AVR_ADC_H_
 
+#include <avr/io.h>                         // Header for special function registers
+#include <avr/interrupt.h>                  // Header for interrupt service routines
+
 #include "emstream.h"                       // Header for serial ports and devices
 #include "FreeRTOS.h"                       // Header for the FreeRTOS RTOS
 #include "task.h"                           // Header for FreeRTOS task functions
@@ -37,12 +43,138 @@
 #include "semphr.h"                         // Header for FreeRTOS semaphores
 
 
+/// The most channels which can be in the scan list
+#define ADC_SCAN_MAX        8
+
+/// The most conversions of each channel which can be added up in one pass of a scan
+#define ADC_SCAN_SAMPLES    64
+
+/** The most conversions of each channel in one pass of a scan when the driver is
+ *  compiled with @c -DADC_LOCKIN; the signed sums must fit in 16 bits. */
+#define ADC_LOCKIN_SAMPLES  32
+
+/** The most bits of resolution which @c read_decimated() can add to the A/D's 10; 
+ *  each one takes four times as many conversions, and 64 of them fill 16 bits. */
+#define ADC_EXTRA_BITS_MAX  3
+
+/** The rate in Hz at which timer 0 starts conversions during a scan, shared among all
+ *  the channels in it. A conversion takes about 108 us, so it can't be much faster. */
+#ifndef ADC_TRIGGER_HZ
+	#define ADC_TRIGGER_HZ  5000
+#endif
+
+/** With @c -DADC_AUTORANGE, readings are on the scale of the AVCC reference with this
+ *  many extra bits, whichever reference they were made with. */
+#define ADC_RANGE_BITS      2
+
+/// The AVCC reference voltage in millivolts
+#define ADC_AVCC_MV         5000
+
+/// The internal reference voltage which auto-ranging uses for small signals, in mV
+#define ADC_INTERNAL_MV     2560
+
+/** When a scan's largest conversion on AVCC is below this, the scan switches to the
+ *  internal reference. It's about 2.2 V, which reads 875 on the internal reference,
+ *  leaving room below @c ADC_RANGE_DOWN so the scan doesn't switch back and forth. */
+#define ADC_RANGE_UP        448
+
+/** When a scan's largest conversion on the internal reference reaches this, the scan
+ *  switches back to AVCC before the internal reference clips. */
+#define ADC_RANGE_DOWN      1000
+
+/** The number of conversions thrown away after the reference is switched, while the
+ *  capacitor on AREF charges to the new voltage; by default those in 20 ms. */
+#ifndef ADC_RANGE_SETTLE
+	#define ADC_RANGE_SETTLE  (ADC_TRIGGER_HZ / 50)
+#endif
+
+/// The number of requests which can wait in each of the A/D request queues
+#define ADC_QUEUE_SIZE      4
+
+/// The priorities of A/D conversion requests; each one has its own queue
+enum adc_priority_t
+{
+	ADC_PRIORITY_LOW,                       ///< Served when no high priority one waits
+	ADC_PRIORITY_HIGH,                      ///< Served first, such as motor currents
+	ADC_PRIORITIES                          ///< The number of priorities
+};
+
+//-------------------------------------------------------------------------------------
+/** @brief   This structure holds a task's request for an A/D reading.
+ *  @details The reading and the semaphore belong to the task which made the request;
+ *           it mustn't touch the reading until the ISR has given the semaphore.
+ */
+
+struct adc_request_t
+{
+	uint8_t            channel;             ///< The channel to be converted
+	uint8_t            samples;             ///< The number of conversions to average
+	uint16_t*          p_reading;           ///< Where the average is put
+	SemaphoreHandle_t  done;                ///< Given by the ISR once it has been put
+};
+
+//-------------------------------------------------------------------------------------
+/** @brief   This structure holds the A/D converter's queues of requests and the one 
+ *           being converted.
+ */
+
+struct adc_server_t
+{
+	QueueHandle_t  queues[ADC_PRIORITIES];  ///< Waiting requests at each priority
+	adc_request_t  request;                 ///< The request being converted
+	uint16_t       sum;                     ///< Sum of its conversions so far
+	uint8_t        taken;                   ///< The number of conversions so far
+	uint8_t        busy;                    ///< Nonzero while a request is converted
+};
+
+//-------------------------------------------------------------------------------------
+/** @brief   This structure holds everything the A/D converter's interrupt service
+ *           routine needs to run a scan.
+ *  @details A scan converts each channel in the list in turn, over and over, adding
+ *           up the conversions of each channel. When it has been through the whole 
+ *           list @c samples times, the sums it was filling become the newest complete
+ *           pass and it starts filling the other set. Tasks must only read this with
+ *           interrupts off, which @c adc does.
+ */
+
+struct adc_scan_t
+{
+	uint8_t   channels[ADC_SCAN_MAX];       ///< The channels to scan, in order
+	uint8_t   count;                        ///< The number of channels in the list
+	uint8_t   samples;                      ///< Conversions per channel in each pass
+	uint8_t   index;                        ///< Which channel is being converted
+	uint8_t   taken;                        ///< Times through the list in this pass
+	uint8_t   fill;                         ///< Which set of sums is being filled
+	uint8_t   ready;                        ///< Which set holds the newest whole pass
+	uint16_t  passes;                       ///< Number of complete passes so far
+	TickType_t finished;                    ///< The RTOS time the last pass finished
+	uint16_t  sums[2][ADC_SCAN_MAX];        ///< Sums of conversions for each channel
+	
+	#ifdef ADC_LOCKIN
+		/// The quadrature sums for each channel; @c sums holds the in-phase ones
+		uint16_t  quadrature[2][ADC_SCAN_MAX];
+	#endif
+	
+	#ifdef ADC_AUTORANGE
+		uint16_t  peak;                     ///< The largest conversion in this pass
+		uint8_t   settle;                   ///< Conversions left to throw away
+		uint8_t   internal;                 ///< Nonzero when on the internal reference
+		uint8_t   ranges[2];                ///< The reference each set of sums used
+	#endif
+};
+
+
 //-------------------------------------------------------------------------------------
 /** @brief   This class will run the A/D converter on an AVR processor.
  *  @details The class contains a protected pointer  to the serial port for outputs.
  * 			 Public functions read_once and read_oversampled perform A/D conversions
  * 			 and emstream prints the A/D conversion value for each channel and the 
- * 			 ADSCRA, ADMUX registers.
+ * 			 ADSCRA, ADMUX registers. Public functions start_scan and get_scan run the
+ * 			 converter from its conversion complete interrupt through a list of
+ * 			 channels, so a task can take the newest readings without waiting.
+ * 			 Public function request queues a reading for the same interrupt to
+ * 			 make between the scan's conversions. Only one object of this class 
+ * 			 should be made, in main(), and shared by all the tasks which use it.
  */
 
 class adc
@@ -50,6 +182,21 @@ class adc
 	protected:
 		/// The ADC class uses this pointer to the serial port to say hello
 		emstream* ptr_to_serial;
+		
+		/// The scan state, which belongs to the A/D converter's ISR
+		static adc_scan_t scan;
+		
+		/// The request queues and the request being served, which belong to the ISR
+		static adc_server_t server;
+		
+		// This method sets the multiplexer to a channel, keeping the reference bits
+		static void select (uint8_t channel);
+		
+		// This method adds a finished conversion to the scan
+		static void add_to_scan (void);
+		
+		// This method takes the next waiting request, if there is one
+		static void next_request (BaseType_t* p_woken);
 
     public:
 		// The constructor sets up the A/D converter for use. The "= NULL" part is a
@@ -65,6 +212,34 @@ class adc
 		// This function reads the A/D lots of times and returns the average. Doing so
 		// implements a crude sort of low-pass filtering that can help reduce noise
 		uint16_t read_oversampled (uint8_t, uint8_t);
+		
+		// This method oversamples by a power of four and shifts the sum, giving up to
+		// 13 bits of resolution
+		uint16_t read_decimated (uint8_t channel, uint8_t extra_bits);
+		
+		// This method reads the channels in a bit mask, interleaving their conversions
+		// so that all the averages cover the same time
+		void read_channels (uint8_t mask, uint16_t* readings, uint8_t samples);
+		
+		// This method starts the A/D scanning a list of channels under interrupt 
+		// control; read_once() and read_oversampled() can't be used while it runs
+		void start_scan (const uint8_t* channels, uint8_t count, uint8_t samples);
+		
+		// This method stops the scan once the conversion in progress is done
+		void stop_scan (void);
+		
+		// This method queues a request for a reading; the ISR converts it and gives
+		// the semaphore when it's done, so several tasks can share the converter
+		bool request (uint8_t channel, uint8_t samples, uint16_t* p_reading,
+					  SemaphoreHandle_t done, adc_priority_t priority = ADC_PRIORITY_LOW);
+		
+		// This method copies the averages from the newest complete pass of the scan,
+		// or with -DADC_LOCKIN the amplitudes of the beacon's flashing; with 
+		// -DADC_AUTORANGE they're on a 12-bit scale whatever the reference
+		uint16_t get_scan (uint16_t* readings, TickType_t* p_time = NULL);
+		
+		// This method is run by the A/D converter's ISR when a conversion is done
+		static void isr (void);
 
 }; // end of class adc
 
@@ -0,0 +1,76 @@
+//======================================================================================
+/** @file doublebuffer.h
+ *    This file contains a double buffer through which one task can publish a whole
+ *    structure at a time to other tasks. The writer fills a buffer which nobody else
+ *    can see, then publishes it by switching buffers, so a reader always gets a
+ *    complete set of data from one moment rather than parts of two.
+ *
+ *  Revisions:
+ *    @li 10-16-2026 Original file
+ *
+ *  License:
+ *    This file is copyright 2026 by its authors and released under the Lesser GNU
+ *    Public License, version 2, as the rest of this project is. It is intended for
+ *    educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//======================================================================================
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _DOUBLEBUFFER_H_
+#define _DOUBLEBUFFER_H_
+
+#include <stdint.h>                         // Standard integer types
+#include <util/atomic.h>                    // Blocks of code with interrupts off
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   This class holds two copies of a structure, one which readers copy and one
+ *           which the writer fills.
+ *  @details Only one task may write. It fills in @c back() for as long as it likes,
+ *           without locking anything, then calls @c publish(), which only changes the
+ *           one byte saying which copy is the front. Readers copy the front with
+ *           interrupts off, which takes a few microseconds, so the writer can't publish
+ *           and start refilling that copy halfway through. The back buffer holds old
+ *           data after each publish, so the writer must fill in all of it each time.
+ *  @param   T The type of the structure being shared
+ */
+
+template <class T>
+class double_buffer
+{
+	protected:
+		T                 buffers[2];       ///< The two copies of the structure
+		volatile uint8_t  front;            ///< Which copy the readers get
+
+	public:
+		/// The constructor makes a buffer whose copies are both zeroed
+		double_buffer (void) : buffers (), front (0) { }
+
+		/// Returns the copy which the writer fills, which readers can't see
+		T& back (void) { return (buffers[front ^ 1]); }
+
+		/// Makes the copy the writer has filled the one readers get
+		void publish (void) { front ^= 1; }
+
+		/** Copies the most recently published structure.
+		 *  @param   copy A reference to the structure which gets the copy
+		 */
+		void get (T& copy)
+		{
+			ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+			{
+				copy = buffers[front];
+			}
+		}
+};
+
+#endif // _DOUBLEBUFFER_H_
@@ -0,0 +1,289 @@
+//======================================================================================
+/** @file encoder_bench.cpp
+ *    This file contains a benchmark which runs the encoder decoder on synthetic
+ *    quadrature waveforms. It measures how many processor cycles each edge costs in
+ *    the direct and batched decoders, and feeds the decoder edges at faster and faster
+ *    rates to see where counts start going missing. It runs on the target, from the
+ *    'b' command in @c task_user, with a copy of the encoder whose pins are a variable
+ *    in memory, so the real encoders keep counting while it runs. It is only compiled
+ *    in when @c -DENCODER_BENCH is given in the Makefile.
+ *
+ *  Revisions:
+ *    @li 10-16-2026 Original file
+ *
+ *  License:
+ *    This file is copyright 2026 by its authors and released under the Lesser GNU
+ *    Public License, version 2, as the rest of this project is. It is intended for
+ *    educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//======================================================================================
+
+#ifdef ENCODER_BENCH
+
+#include <stdlib.h>                         // Include standard library header files
+#include <string.h>
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#include "encoder_bench.h"                  // Header for this benchmark
+
+/// The variable which stands in for the benchmark encoder's pin register
+volatile uint8_t encoder_bench_pins;
+
+/// The channel states in the positive direction; channel A is bit 1 and B is bit 0
+static const uint8_t BENCH_WAVE[4] = { 0x00, 0x02, 0x03, 0x01 };
+
+// The edges are timed in whole chunks, each of which must fit in half the edge queue
+static_assert (ENCODER_BENCH_EDGES % ENCODER_BENCH_CHUNK == 0 
+			   && ENCODER_BENCH_CHUNK <= ENCODER_QUEUE_SIZE / 2,
+			   "The benchmark edges must be whole chunks of at most half a queue");
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   This class is an encoder on @c encoder_bench_pins which lets the benchmark
+ *           reset it and feed its decoder directly.
+ *  @details Its pins are bits 1 and 0, so the pin value is the channel state itself.
+ */
+
+class EncoderBench : public Encoder<encoder_port_bench, 1, 0, 1>
+{
+	public:
+		/// Puts the encoder back to a count of zero with no history
+		static void reset (void)
+		{
+			ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+			{
+				memset (&state, 0, sizeof (state));
+				memset (&speed, 0, sizeof (speed));
+				#ifdef ENCODER_BATCHED
+					queue.head = 0;
+					queue.tail = 0;
+					queue.overflows = 0;
+				#endif
+				state.min_interval = ENCODER_MIN_EDGE_TICKS;
+				encoder_bench_pins = BENCH_WAVE[0];
+			}
+		}
+
+		/// Decodes one edge with a given time stamp, as the direct ISR would
+		static void feed (uint8_t pins, uint16_t now)
+		{
+			decode (pins, now);
+		}
+};
+
+
+//-------------------------------------------------------------------------------------
+/** This function converts a number of time stamp ticks spent on all the benchmark 
+ *  edges into processor cycles per edge.
+ *  @param   ticks The number of time stamp ticks
+ *  @return  The number of processor cycles per edge
+ */
+
+static uint16_t cycles_per_edge (uint16_t ticks)
+{
+	return (((uint32_t)ticks * (F_CPU / ENCODER_TIMER_HZ)) / ENCODER_BENCH_EDGES);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function times a loop which only writes the synthetic waveform, so its cost
+ *  can be taken out of the other measurements. Interrupts are off while each chunk 
+ *  of @c ENCODER_BENCH_CHUNK edges runs.
+ *  @return  The number of time stamp ticks the loop took
+ */
+
+static uint16_t time_empty_loop (void)
+{
+	uint16_t start;
+	uint16_t ticks = 0;
+
+	for (uint16_t edge = 1; edge <= ENCODER_BENCH_EDGES; )
+	{
+		ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+		{
+			start = encoder_time ();
+			for (uint8_t count = 0; count < ENCODER_BENCH_CHUNK; count++, edge++)
+			{
+				encoder_bench_pins = BENCH_WAVE[edge & 0x03];
+			}
+			ticks += encoder_time () - start;
+		}
+	}
+	return (ticks);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function times the direct decoder, which is what the ISR runs on each edge
+ *  when the driver isn't batched. The glitch filter is turned off, since the edges
+ *  come much faster than any motor could make them. Each edge is stamped with 
+ *  @c encoder_time(), as in the ISR, so the stamp's cost is in the measurement. 
+ *  Interrupts are off while each chunk of @c ENCODER_BENCH_CHUNK edges runs.
+ *  @return  The number of time stamp ticks taken for all the edges
+ */
+
+static uint16_t time_direct (void)
+{
+	uint16_t start;
+	uint16_t ticks = 0;
+
+	EncoderBench::reset ();
+	EncoderBench::set_min_interval (0);
+	for (uint16_t edge = 1; edge <= ENCODER_BENCH_EDGES; )
+	{
+		ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+		{
+			start = encoder_time ();
+			for (uint8_t count = 0; count < ENCODER_BENCH_CHUNK; count++, edge++)
+			{
+				encoder_bench_pins = BENCH_WAVE[edge & 0x03];
+				EncoderBench::feed (encoder_bench_pins, encoder_time ());
+			}
+			ticks += encoder_time () - start;
+		}
+	}
+	return (ticks);
+}
+
+
+#ifdef ENCODER_BATCHED
+//-------------------------------------------------------------------------------------
+/** This function times the batched decoder. Edges are queued by the ISR method in
+ *  chunks of @c ENCODER_BENCH_CHUNK, and each chunk is drained before the next, so 
+ *  the queue never overflows. Interrupts are off while each chunk is queued and 
+ *  while it is drained.
+ *  @param   drain_ticks Reference to a variable which gets the ticks spent draining
+ *  @return  The number of time stamp ticks spent in the ISR method for all the edges
+ */
+
+static uint16_t time_batched (uint16_t& drain_ticks)
+{
+	uint16_t start;
+	uint16_t isr_ticks = 0;
+
+	EncoderBench::reset ();
+	EncoderBench::set_min_interval (0);
+	drain_ticks = 0;
+	for (uint16_t edge = 1; edge <= ENCODER_BENCH_EDGES; )
+	{
+		ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+		{
+			start = encoder_time ();
+			for (uint8_t count = 0; count < ENCODER_BENCH_CHUNK; count++, edge++)
+			{
+				encoder_bench_pins = BENCH_WAVE[edge & 0x03];
+				EncoderBench::isr ();
+			}
+			isr_ticks += encoder_time () - start;
+		}
+		ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+		{
+			start = encoder_time ();
+			EncoderBench::drain ();
+			drain_ticks += encoder_time () - start;
+		}
+	}
+	return (isr_ticks);
+}
+#endif // ENCODER_BATCHED
+
+
+//-------------------------------------------------------------------------------------
+/** This function feeds the decoder a waveform with a given time between edges, as
+ *  time stamps, and prints how many counts went missing and why.
+ *  @param   p_ser A pointer to the serial device on which results are printed
+ *  @param   period The time between edges in time stamp ticks
+ */
+
+static void sweep_once (emstream* p_ser, uint16_t period)
+{
+	uint16_t now = 0;
+
+	EncoderBench::reset ();
+	for (uint16_t edge = 1; edge <= ENCODER_BENCH_EDGES; edge++)
+	{
+		now += period;
+		encoder_bench_pins = BENCH_WAVE[edge & 0x03];
+		ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+		{
+			EncoderBench::feed (encoder_bench_pins, now);
+		}
+	}
+
+	encoder_errors_t stats = EncoderBench::error_stats ();
+	*p_ser << PMS ("  ") << period * (uint16_t)(1000000UL / ENCODER_TIMER_HZ) 
+		   << PMS (" us, ") << (uint32_t)(ENCODER_TIMER_HZ / period) 
+		   << PMS (" edges/s: lost ")
+		   << ENCODER_BENCH_EDGES - EncoderBench::view_count ()
+		   << PMS (", glitches ") << stats.glitches << PMS (", errors ") << stats.count
+		   << endl;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function runs the encoder benchmark and prints the results. First the cost of
+ *  each decoder is measured in processor cycles per edge, and from that the edge rate
+ *  at which the ISR would take all the processor's time. The ISR's entry and exit
+ *  can't be measured this way, so @c ENCODER_BENCH_ENTRY_CYCLES is added as an
+ *  estimate. Then the decoder is fed edges at rates from 3900 to 250000 edges per
+ *  second with the glitch filter on, showing where the filter starts dropping real
+ *  edges. The decoders are timed in short chunks with interrupts off, since the time
+ *  stamps are only right if the RTOS tick interrupt is held off for under half a 
+ *  tick; the chunks still delay other interrupts, so this shouldn't be run while the
+ *  motors are being driven.
+ *  @param   p_ser A pointer to the serial device on which results are printed
+ */
+
+void encoder_bench_run (emstream* p_ser)
+{
+	uint16_t empty = time_empty_loop ();
+	uint16_t cycles = cycles_per_edge (time_direct () - empty);
+
+	*p_ser << PMS ("Encoder benchmark, ") << ENCODER_BENCH_EDGES << PMS (" edges")
+		   << endl << PMS ("Direct ISR: ") << cycles << PMS (" cycles/edge, CPU full at ")
+		   << (uint32_t)(F_CPU / (cycles + ENCODER_BENCH_ENTRY_CYCLES)) << PMS (" edges/s");
+	if (EncoderBench::view_count () != ENCODER_BENCH_EDGES)
+	{
+		*p_ser << PMS (", miscounted ") << EncoderBench::view_count ();
+	}
+	*p_ser << endl;
+
+	#ifdef ENCODER_BATCHED
+		uint16_t drain_ticks;
+		cycles = cycles_per_edge (time_batched (drain_ticks) - empty);
+
+		*p_ser << PMS ("Batched ISR: ") << cycles << PMS (" cycles/edge, CPU full at ")
+			   << (uint32_t)(F_CPU / (cycles + ENCODER_BENCH_ENTRY_CYCLES)) << PMS (" edges/s")
+			   << endl << PMS ("Batched drain: ") << cycles_per_edge (drain_ticks)
+			   << PMS (" cycles/edge, queue full at ")
+			   << (uint32_t)(ENCODER_QUEUE_SIZE * 1000UL)
+			   << PMS (" edges/s if drained every ms") << endl;
+		if (EncoderBench::view_count () != ENCODER_BENCH_EDGES)
+		{
+			*p_ser << PMS ("Batched decoder miscounted ") << EncoderBench::view_count ()
+				   << endl;
+		}
+	#else
+		*p_ser << PMS ("Batched decoder not compiled in (-DENCODER_BATCHED)") << endl;
+	#endif
+
+	*p_ser << PMS ("Glitch filter at ") << ENCODER_MIN_EDGE_TICKS
+		   << PMS (" ticks; edge period:") << endl;
+	for (uint16_t period = 64; period > 0; period >>= 1)
+	{
+		sweep_once (p_ser, period);
+	}
+	EncoderBench::reset ();
+}
+
+#endif // ENCODER_BENCH
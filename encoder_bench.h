@@ -0,0 +1,81 @@
+//======================================================================================
+/** @file encoder_bench.h
+ *    This file contains the header for a benchmark which runs the encoder decoder on
+ *    synthetic quadrature waveforms, to find the edge rate at which counts go missing.
+ *    It is only compiled in when @c -DENCODER_BENCH is given in the Makefile.
+ *
+ *  Revisions:
+ *    @li 10-16-2026 Original file
+ *
+ *  License:
+ *    This file is copyright 2026 by its authors and released under the Lesser GNU
+ *    Public License, version 2, as the rest of this project is. It is intended for
+ *    educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//======================================================================================
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _ENCODER_BENCH_H_
+#define _ENCODER_BENCH_H_
+
+#include <stdlib.h>                         // Prototype declarations for I/O functions
+#include <avr/io.h>                         // Header for special function registers
+
+#include "emstream.h"                       // Header for serial ports and devices
+#include "encoder_driver.h"                 // Header for the encoder driver class
+
+/// The number of synthetic edges fed to the decoder for each measurement
+#define ENCODER_BENCH_EDGES     256
+
+/** The number of edges timed at a time with interrupts off. The time stamps from 
+ *  @c encoder_time() are only right if the RTOS tick interrupt is held off for less 
+ *  than half a tick, 8000 cycles, so a chunk must take well under that even with the
+ *  slowest decoder. It must divide @c ENCODER_BENCH_EDGES and be no more than half 
+ *  of @c ENCODER_QUEUE_SIZE. */
+#define ENCODER_BENCH_CHUNK     16
+
+/** An estimate of the processor cycles taken to get into and out of an external
+ *  interrupt, which the benchmark can't see: the interrupt response and jump to the
+ *  vector, the registers the compiler saves and restores, and the @c reti. */
+#define ENCODER_BENCH_ENTRY_CYCLES  60
+
+/// The pin register which the benchmark writes its synthetic waveforms into
+extern volatile uint8_t encoder_bench_pins;
+
+//-------------------------------------------------------------------------------------
+/** @brief   This class describes a port which is only a variable in memory, for use as
+ *           the @c PORT of an @c Encoder being benchmarked.
+ *  @details The benchmark encoder's channels are bits 0 and 1 of
+ *           @c encoder_bench_pins. Its constructor is never run, so the other
+ *           registers are never written; they point at a spare byte anyway.
+ */
+
+class encoder_port_bench
+{
+	public:
+		/// The variable which stands in for the input register
+		static volatile uint8_t& pin (void) { return encoder_bench_pins; }
+
+		/// The other registers aren't used, so they're all the same spare byte
+		static volatile uint8_t& port (void) { return encoder_bench_pins; }
+		static volatile uint8_t& ddr (void) { return encoder_bench_pins; }
+		static volatile uint8_t& eicr (void) { return encoder_bench_pins; }
+
+		/// There's no interrupt, so the pin number stands in for it
+		static constexpr uint8_t int_number (uint8_t a_pin) { return a_pin; }
+		static constexpr uint8_t isc_bit (uint8_t a_pin) { return 0; }
+};
+
+// This function runs the encoder benchmark and prints the results
+void encoder_bench_run (emstream* p_ser);
+
+#endif // _ENCODER_BENCH_H_
@@ -30,6 +30,10 @@
 #ifndef ENCODER_DRIVER
 #define ENCODER_DRIVER
 
+#include <avr/io.h>                         // Header for special function registers
+#include <avr/interrupt.h>                  // Header for interrupt service routines
+#include <util/atomic.h>                    // Header for interrupt-safe blocks of code
+
 #include "emstream.h"                       // Header for serial ports and devices
 #include "FreeRTOS.h"                       // Header for the FreeRTOS RTOS
 #include "task.h"                           // Header for FreeRTOS task functions
@@ -39,65 +43,1409 @@
 #include "textqueue.h"                      // Header of wrapper for FreeRTOS queues
 #include "shares.h"							// Shared inter-task communications
 
+/** The rate in Hz at which encoder edges are time stamped. The stamps are made from
+ *  the RTOS tick timer, which the FreeRTOS port runs at F_CPU / 64, or every 4 us. */
+#define ENCODER_TIMER_HZ    (F_CPU / 64)
+
+/// The number of time stamp ticks in each RTOS tick; the tick timer counts this many
+#define ENCODER_TICK_COUNTS (ENCODER_TIMER_HZ / configTICK_RATE_HZ)
+
+/** The FreeRTOS port puts its tick on timer 5 where there is one, and on timer 3 on 
+ *  64-pin parts such as the ATmega1281, which have no timers 4 and 5; in either case
+ *  the timer clears on compare match A once a tick. */
+#ifdef OCR5A
+	#define ENCODER_TICK_TCNT   TCNT5
+	#define ENCODER_TICK_TIFR   TIFR5
+	#define ENCODER_TICK_FLAG   OCF5A
+#else
+	#define ENCODER_TICK_TCNT   TCNT3
+	#define ENCODER_TICK_TIFR   TIFR3
+	#define ENCODER_TICK_FLAG   OCF3A
+#endif
+
+/// The number of recent edge periods kept for each encoder's velocity estimate
+#define ENCODER_PERIODS     8
+
+/** If at least this many counts go by in one velocity window, the velocity is measured
+ *  as counts per window; below it, it is measured from the edge periods. */
+#define ENCODER_FAST_EDGES  ENCODER_PERIODS
+
+/// An encoder with no edges for this many timer ticks (100 ms) is taken to be stopped
+#define ENCODER_STOP_TICKS  (ENCODER_TIMER_HZ / 10)
+
+/** An edge which comes less than this many timer ticks (20 us) after the last legal
+ *  edge shows that one of the two was noise, and both are dropped. It should be well
+ *  under the shortest edge period the motor can really make; it can be changed at run
+ *  time with @c set_min_interval().
+ */
+#ifndef ENCODER_MIN_EDGE_TICKS
+	#define ENCODER_MIN_EDGE_TICKS  5
+#endif
+
+/** The number of bins in each encoder's histogram of the time from the last legal edge
+ *  to an illegal transition. Bin 0 holds times under 16 timer ticks (64 us), each bin
+ *  after that covers twice the time of the one before, and the last bin holds the rest.
+ */
+#define ENCODER_ERROR_BINS  8
+
+/** Interpolated positions are fixed point numbers of counts with this many bits after
+ *  the binary point, so one count is @c ENCODER_ONE. */
+#define ENCODER_FRACTION_BITS  8
+
+/// One encoder count in interpolated position units
+#define ENCODER_ONE  ((int32_t)1 << ENCODER_FRACTION_BITS)
+
+/** With @c -DENCODER_HW_COUNTER, the base encoder hands its counting over to timer 3 
+ *  when it goes faster than this many counts per second. This only builds for parts
+ *  with a timer 5 to make the RTOS tick, since timer 3 makes it otherwise... */
+#define ENCODER_HW_ENTER_CPS  8000
+
+/// ...and takes it back from timer 3 when it slows below this many counts per second
+#define ENCODER_HW_EXIT_CPS   4000
+
+/** The number of raw edges each encoder's queue can hold when the driver is compiled 
+ *  with @c -DENCODER_BATCHED; it must be a power of two. */
+#define ENCODER_QUEUE_SIZE  64
+
+//-------------------------------------------------------------------------------------
+/** @brief   This structure holds the illegal transition statistics for one encoder.
+ *  @details A burst of errors at short intervals points to missed edges at high speed
+ *           or noise, while errors after long quiet times point to something else, so
+ *           the interval histogram is the first thing to look at when counts go missing.
+ */
+
+struct encoder_errors_t
+{
+	uint32_t  count;                        ///< Number of illegal transitions seen
+	uint32_t  glitches;                     ///< Number of edges ignored as noise
+	TickType_t last_time;                   ///< RTOS tick time of the most recent one
+	int32_t   last_position;                ///< Encoder count when it happened
+	uint16_t  intervals[ENCODER_ERROR_BINS]; ///< Histogram of time since a legal edge
+};
+
+//-------------------------------------------------------------------------------------
+/** @brief   This structure holds what the last legal edge changed in an encoder's
+ *           state block, so that the edge can be taken back if it turns out to have
+ *           been noise.
+ */
+
+struct encoder_undo_t
+{
+	int8_t    delta;                        ///< The edge's step, or 0 if there's none
+	uint8_t   state_old;                    ///< The channel state before it
+	int8_t    direction;                    ///< The direction before it
+	uint8_t   stamped;                      ///< @c stamped before it
+	uint8_t   reversed;                     ///< @c reversed before it
+	uint16_t  last_edge;                    ///< @c last_edge before it
+	uint16_t  period;                       ///< The ring slot its period overwrote
+};
+
+//-------------------------------------------------------------------------------------
+/** @brief   This structure holds everything an encoder's interrupt service routine
+ *           needs to decode an edge.
+ *  @details Each encoder has one of these blocks, and only that encoder's ISR writes
+ *           to it while running (or, in batched mode, the task draining its edge queue
+ *           with interrupts off). Tasks must never read it directly, because the 32-bit
+ *           members can change halfway through a read; they use the @c Encoder methods
+ *           instead, which copy it with interrupts off.
+ */
+
+struct encoder_state_t
+{
+	int32_t   count;                        ///< Position in encoder ticks
+	encoder_errors_t errors;                ///< Illegal transition statistics
+	uint8_t   state_old;                    ///< Previous two-bit channel state
+	int8_t    direction;                    ///< Sign of the most recent legal step
+	uint8_t   stamped;                      ///< Nonzero if @c last_edge can be used
+	uint8_t   reversed;                     ///< Nonzero if the periods are pre-reversal
+	uint8_t   period_index;                 ///< Where the next period goes in the ring
+	uint16_t  last_edge;                    ///< Time stamp of the last legal edge
+	uint16_t  min_interval;                 ///< Shortest believable edge period
+	uint32_t  period_sum;                   ///< Sum of everything in @c periods
+	uint16_t  periods[ENCODER_PERIODS];     ///< Ring of recent edge periods, or 0
+	encoder_undo_t undo;                    ///< How to take back the last legal edge
+};
+
+//-------------------------------------------------------------------------------------
+/** @brief   This structure is a single-producer, single-consumer queue of raw edges.
+ *  @details When the driver is compiled with @c -DENCODER_BATCHED, the encoder's ISR
+ *           only copies the pin register and a time stamp into this queue, and 
+ *           @c task_encoder decodes the queued edges in batches. The ISR is the only
+ *           writer of @c head and the task the only writer of @c tail, and each is one
+ *           byte, so no lock is needed. If the queue is full the edge is dropped and
+ *           @c overflows is incremented; the decoder then sees a skipped state.
+ */
+
+struct encoder_queue_t
+{
+	volatile uint8_t head;                  ///< Where the ISR puts the next edge
+	volatile uint8_t tail;                  ///< Where the task takes the next edge
+	uint8_t   pins[ENCODER_QUEUE_SIZE];     ///< Pin register value at each edge
+	uint16_t  stamps[ENCODER_QUEUE_SIZE];   ///< Time stamp of each edge
+	uint16_t  overflows;                    ///< Number of edges dropped, queue full
+};
+
+/** @brief   This structure holds the task-side state of an encoder's velocity estimate.
+ *  @details It is written by @c update_velocity(), which is run by one task, and by
+ *           @c set_count(), which may be run by another, so both change it with 
+ *           interrupts off. */
+struct encoder_speed_t
+{
+	int32_t   window_count;                 ///< Count at the start of this window
+	uint16_t  window_stamp;                 ///< Time stamp of the start of the window
+	int32_t   velocity;                     ///< Most recent estimate in counts per second
+};
+
+/// @brief   This structure is a consistent copy of one encoder's count and errors.
+struct encoder_snapshot_t
+{
+	int32_t   count;                        ///< Position in encoder ticks
+	uint32_t  errors;                       ///< Number of illegal transitions seen
+};
+
+//-------------------------------------------------------------------------------------
+/** @brief   This structure holds the state of an encoder which is being counted by a
+ *           hardware timer.
+ *  @details While the timer counts, the position is worked out from the count, phase
+ *           and timer reading at the last reference point plus the rising edges of 
+ *           channel A counted since then. Only the task running @c update_velocity()
+ *           changes it, with interrupts off, so other tasks can read it atomically.
+ */
+
+struct encoder_counter_t
+{
+	uint8_t   active;                       ///< Nonzero while the timer is counting
+	int8_t    direction;                    ///< Direction latched at the handover
+	uint8_t   phase;                        ///< Quadrature phase at the reference point
+	uint16_t  edges;                        ///< Timer reading at the reference point
+	int32_t   count;                        ///< Encoder count at the reference point
+	uint16_t  handovers;                    ///< Number of times the timer took over
+};
+
+// This table holds the count change for each (old << 2 | new) quadrature transition
+extern const int8_t ENCODER_TABLE[16];
+
+//-------------------------------------------------------------------------------------
+/** @brief   Decodes one quadrature transition with a single table lookup.
+ *  @param   state_old The previous two-bit state, channel A in bit 1 and B in bit 0
+ *  @param   state The new two-bit state, channel A in bit 1 and B in bit 0
+ *  @return  +1 or -1 for a legal step, or 0 if the transition was illegal
+ */
+
+inline int8_t encoder_decode (uint8_t state_old, uint8_t state)
+{
+	return ENCODER_TABLE[((state_old & 0x03) << 2) | state];
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Converts a two-bit channel state into a phase which goes 0, 1, 2, 3 as the
+ *           encoder moves in the positive direction.
+ *  @details This is a Gray code to binary conversion: the high bit is channel B and
+ *           the low bit is A exclusive-or B.
+ *  @param   state The two-bit state, channel A in bit 1 and B in bit 0
+ *  @return  The phase, from 0 to 3
+ */
+
+inline uint8_t encoder_phase (uint8_t state)
+{
+	return ((state & 0x01) << 1) | (((state >> 1) ^ state) & 0x01);
+}
+
 //-------------------------------------------------------------------------------------
-/** @brief   This class will read an encoder connected to the AVR processor by any of
- * 			 the external input pins 4 through 7.
- *  @details The class contains a protected pointer to the serial port for outputs.
- * 			 It also contains pointers for encoder PORTs, DDRs, and pin addresses.
- * 			 Public function error_count displays the number of errors accumulated.
+/** @brief   Returns the time now in @c ENCODER_TIMER_HZ ticks, for time stamping edges.
+ *  @details The ATmega1281 has no timer to spare for this, so the time is made from 
+ *           the RTOS tick count and the count of the tick timer, which only the RTOS
+ *           port sets up. If the timer has cleared but the tick interrupt hasn't run
+ *           yet, the tick count is one behind; the compare flag shows this. It must be
+ *           called with interrupts off, as in an ISR, and they mustn't have been held
+ *           off for more than half a tick, or a tick can be missed. The time rolls over
+ *           every 262 ms, which is longer than @c ENCODER_STOP_TICKS, so unsigned 
+ *           subtraction always gives the right period.
+ *  @return  The time, which rolls over at 65536
+ */
+
+inline uint16_t encoder_time (void)
+{
+	uint16_t count = ENCODER_TICK_TCNT;
+	uint16_t ticks = (uint16_t)xTaskGetTickCountFromISR ();
+
+	if ((ENCODER_TICK_TIFR & (1 << ENCODER_TICK_FLAG)) 
+		&& count < ENCODER_TICK_COUNTS / 2)
+	{
+		ticks++;
+	}
+	return (ticks * ENCODER_TICK_COUNTS + count);
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   This class describes PORTE, where external interrupts INT4 through INT7
+ *           come in on pins PE4 through PE7, for use as the @c PORT of an @c Encoder.
+ *  @details Each method returns a reference to a fixed register, so once inlined it
+ *           compiles into a single I/O instruction with no pointer kept in memory.
+ */
+
+class encoder_port_e
+{
+	public:
+		/// The input register which is read by the ISR
+		static volatile uint8_t& pin (void) { return PINE; }
+		
+		/// The output register, used to turn on pullup resistors
+		static volatile uint8_t& port (void) { return PORTE; }
+		
+		/// The data direction register
+		static volatile uint8_t& ddr (void) { return DDRE; }
+		
+		/// The external interrupt control register which sets the sense of each pin
+		static volatile uint8_t& eicr (void) { return EICRB; }
+		
+		/// The external interrupt number wired to a pin; on PORTE it is the pin number
+		static constexpr uint8_t int_number (uint8_t a_pin) { return a_pin; }
+		
+		/// The bit in @c eicr() which makes an external interrupt fire on any change
+		static constexpr uint8_t isc_bit (uint8_t a_pin) { return 2 * (a_pin - 4); }
+};
+
+//-------------------------------------------------------------------------------------
+/** @brief   This class will read an encoder connected to the AVR processor by any two
+ * 			 external interrupt pins.
+ *  @details The port and pins are template parameters, so the bit masks the ISR uses
+ *           are constants and each edge costs one read of the pin register with no
+ *           shifts done at run time. Every instantiation of the template has its own
+ *           ISR state block; adding an encoder only takes a new @c typedef and a line
+ *           with @c ENCODER_ISR(). The constructor sets up the pins and interrupts. 
+ *           Public function error_count returns the number of errors accumulated.
  * 			 Public function clear_count zeros the encoder count. Public function
- * 			 view_count displays the current encoder count.  Public function set_count
+ * 			 view_count returns the current encoder count.  Public function set_count
  * 			 sets the encoder count according to a user input.
+ *  @param   PORT A class such as @c encoder_port_e describing the port's registers
+ *  @param   PIN_A The bit number in the port of encoder channel A
+ *  @param   PIN_B The bit number in the port of encoder channel B
+ *  @param   VECTOR The number of the external interrupt which channel A triggers
  */
 
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR>
 class Encoder
 {
+	static_assert (PORT::int_number (PIN_A) == VECTOR, 
+				   "Channel A must be on the pin wired to the encoder's interrupt");
+	
 	protected:
 		/// The Encoder class uses this pointer to the serial port to say hello
 		emstream* ptr_to_serial;
 		
-		// Pointers to encoder PORTs, DDRs, and pin addresses
-		volatile uint8_t* INTERRUPT_PORT;
-		volatile uint8_t* INTERRUPT_DDR;
-		uint8_t   INTERRUPT_PIN_0_A;
-		uint8_t   INTERRUPT_PIN_1_A;
-		uint8_t   INTERRUPT_PIN_0_B;
-		uint8_t   INTERRUPT_PIN_1_B;
-		uint8_t   EXT_PIN_NUMBER_A;
-		uint8_t   EXT_PIN_NUMBER_B;
-		
-		// Storage variables for encoder class
-		uint32_t  ENCODER_COUNT;
-		uint32_t  ERROR_COUNT;
-		uint8_t   STATE;
-		uint8_t   STATE_OLD;
+		/// The state block which belongs to this encoder's ISR
+		static encoder_state_t state;
+		
+		/// The velocity estimate, which belongs to the task running @c update_velocity()
+		static encoder_speed_t speed;
+		
+		#ifdef ENCODER_BATCHED
+			/// The queue of raw edges between the ISR and @c task_encoder
+			static encoder_queue_t queue;
+		#endif
+		
+		// This method forgets all edge periods, as when the encoder stops or reverses
+		static void clear_periods (void);
+		
+		// This method decodes one edge from a pin register value and its time stamp
+		static void decode (uint8_t pins, uint16_t now);
+		
+		// This method adds an illegal transition to the error statistics
+		static void record_error (uint16_t now);
+		
+		// This method takes back the last legal edge, which turned out to be noise
+		static void undo (void);
+		
+		/// Bit masks for the two channels in the pin register
+		static constexpr uint8_t MASK_A = (1 << PIN_A);
+		static constexpr uint8_t MASK_B = (1 << PIN_B);
+		
+		// This method packs the two channels from a pin register into a two-bit state
+		static uint8_t read_state (uint8_t pins);
 
     public:
 		// The constructor sets up the Encoder driver for use. The "= NULL" part is a
 		// default parameter, meaning that if that parameter isn't given on the line
 		// where this constructor is called, the compiler will just fill in "NULL".
 		// In this case that has the effect of turning off diagnostic printouts
-		Encoder (emstream* = NULL, volatile uint8_t* i_port = NULL,
-				 volatile uint8_t* i_ddr = NULL, volatile uint8_t* i_port_in = NULL,
-				 uint8_t i_pin_0_a = 0, uint8_t i_pin_1_a = 0, uint8_t e_pin_a = 0,
-				 uint8_t i_pin_0_b = 0, uint8_t i_pin_1_b = 0, uint8_t e_pin_b = 0);
+		Encoder (emstream* = NULL);
+		
+		// This method is run by the encoder's interrupt service routine on each edge
+		static void isr (void);
+		
+		// Method which copies the count and error count without the ISR interfering
+		static encoder_snapshot_t snapshot (void);
 		
 		// Method that counts errors
-		uint16_t error_count(uint8_t enc_num);
+		static uint32_t error_count (void);
+		
+		// Method which copies the illegal transition statistics
+		static encoder_errors_t error_stats (void);
+		
+		// Method which prints the illegal transition statistics
+		static void print_stats (emstream& serpt);
 		
 		// Method that clears the encoder count
-		void clear_count(uint8_t enc_num);
+		static void clear_count (void);
 		
 		// Method that allows for encoder count viewing
-		void view_count(uint8_t enc_num);
+		static int32_t view_count (void);
+		
+		// Method which returns the position interpolated between edges, in fixed point
+		static int32_t view_position (void);
 		
 		// Method that sets encoder count
-		void set_count(uint8_t enc_num, uint32_t NEW_COUNT);
+		static void set_count (int32_t NEW_COUNT);
+		
+		// Method which decodes queued edges in batched mode; it's run often by one task
+		static void drain (void);
+		
+		// Method which returns the number of edges dropped because the queue was full
+		static uint16_t overflow_count (void);
+		
+		// Method which updates the velocity estimate; it's run often by one task
+		static void update_velocity (void);
+		
+		// Method which returns the most recent velocity estimate in counts per second
+		static int32_t velocity (void);
+		
+		// Method which sets the shortest time between edges which isn't called noise
+		static void set_min_interval (uint16_t ticks);
 
 }; // end of class Encoder
 
-// This operator prints the Encoder diagnostics (see file Encoder.cpp for details). It's not 
-// a part of class Encoder, but it operates on objects of class Encoder
-emstream& operator << (emstream&, Encoder&);
+//-------------------------------------------------------------------------------------
+/** @brief   This class describes timer/counter 3 clocked by rising edges on its T3
+ *           pin, PE6, for use as the @c COUNTER of a @c CountedEncoder.
+ *  @details Timer 3 is only free on parts whose FreeRTOS port puts the RTOS tick on 
+ *           timer 5. On the ATmega1281, which has no timer 5, timer 3 is the tick 
+ *           timer and this counter can't be used. Nothing else may change timer 3's 
+ *           setup while an encoder is counting with it.
+ */
+
+class encoder_counter_3
+{
+	public:
+		/// The pin of PORTE which clocks the counter
+		static constexpr uint8_t CLOCK_PIN = PE6;
+		
+		/// Starts the counter counting rising edges on the clock pin
+		static void start (void)
+		{
+			TCCR3A = 0;
+			TCCR3B = (1 << CS32) | (1 << CS31) | (1 << CS30);
+		}
+		
+		/// Reads the number of rising edges counted, which rolls over at 65536
+		static uint16_t count (void) { return TCNT3; }
+};
+
+//-------------------------------------------------------------------------------------
+/** @brief   This class reads an encoder with external interrupts at low speed and 
+ *           with a hardware counter at high speed.
+ *  @details Each edge costs an interrupt, so at high speed an encoder can take a lot
+ *           of processor time. When this encoder goes faster than
+ *           @c ENCODER_HW_ENTER_CPS, @c update_velocity() turns off its external 
+ *           interrupts and a timer clocked by channel A counts the rising edges 
+ *           instead, one for every four counts. The direction, which the ISR found from
+ *           channel B, is latched from the velocity at the handover; it can't reverse
+ *           without first slowing below @c ENCODER_HW_EXIT_CPS, where the interrupts
+ *           are turned back on. Every count change is worked out from the number of
+ *           rising edges \c n and the phases at both ends as 
+ *           <tt>dir * 4n + ((exit - R) & 3) - ((entry - R) & 3)</tt>, where \c R is 1
+ *           going forward, the phase just after a rising edge of channel A, and 3 going
+ *           backward, the phase just before one, so no counts are lost or gained 
+ *           across a handover. The methods used by other tasks have
+ *           the same names as in @c Encoder, so their code doesn't change.
+ *  @param   COUNTER A class such as @c encoder_counter_3 describing the counter
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR, class COUNTER>
+class CountedEncoder : public Encoder<PORT, PIN_A, PIN_B, VECTOR>
+{
+	static_assert (COUNTER::CLOCK_PIN == PIN_A, 
+				   "The counter must be clocked by the encoder's channel A");
+	
+	protected:
+		/// The interrupt-driven encoder which this one is built upon
+		typedef Encoder<PORT, PIN_A, PIN_B, VECTOR> Base;
+		
+		/// The state of the hardware counter
+		static encoder_counter_t counter;
+		
+		/// Bits in @c EIMSK and @c EIFR for the two channels' external interrupts
+		static constexpr uint8_t INT_BITS = (1 << PORT::int_number (PIN_A)) 
+										  | (1 << PORT::int_number (PIN_B));
+		
+		// This method reads the counter and the phase at the same instant
+		static uint8_t read_counter (uint16_t& edges);
+		
+		// This method works out the count from the counter; interrupts must be off
+		static int32_t counted (void);
+		
+		// This method moves the counter's reference point up to the present
+		static void rebase (void);
+		
+		// This method hands counting over from the interrupts to the counter
+		static void enter_counter (int8_t direction);
+		
+		// This method hands counting back from the counter to the interrupts
+		static void leave_counter (void);
+
+	public:
+		// The constructor sets up the interrupts and starts the counter
+		CountedEncoder (emstream* = NULL);
+		
+		// Method which copies the count and error count
+		static encoder_snapshot_t snapshot (void);
+		
+		// Method that clears the encoder count
+		static void clear_count (void);
+		
+		// Method that allows for encoder count viewing
+		static int32_t view_count (void);
+		
+		// Method which returns the position, interpolated only at low speed
+		static int32_t view_position (void);
+		
+		// Method that sets encoder count
+		static void set_count (int32_t NEW_COUNT);
+		
+		// Method which updates the velocity and hands counting over if needed
+		static void update_velocity (void);
+		
+		// Method which prints the error statistics and the counter's state
+		static void print_stats (emstream& serpt);
+		
+}; // end of class CountedEncoder
+
+/// The encoder which measures the gun angle, on pins PE4 and PE5
+typedef Encoder<encoder_port_e, PE4, PE5, INT4> GunEncoder;
+
+#ifdef ENCODER_HW_COUNTER
+	// Timer 3 makes the RTOS tick, and the edge time stamps, unless there's a timer 5
+	#ifndef OCR5A
+		#error "ENCODER_HW_COUNTER needs timer 3, which is the RTOS tick timer here"
+	#endif
+	
+	/// The encoder which measures the base rotation, counted by timer 3 at high speed
+	typedef CountedEncoder<encoder_port_e, PE6, PE7, INT6, encoder_counter_3> 
+		BaseEncoder;
+#else
+	/// The encoder which measures the base rotation, on pins PE6 and PE7
+	typedef Encoder<encoder_port_e, PE6, PE7, INT6> BaseEncoder;
+#endif
+
+/** This macro creates the interrupt service routine for an encoder type. Channel A's
+ *  vector runs the encoder's @c isr() method and channel B's vector is aliased to it.
+ */
+#define ENCODER_ISR(enc_type, vect_a, vect_b) \
+	ISR (vect_a) { enc_type::isr (); } \
+	ISR_ALIAS (vect_b, vect_a)
+
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR>
+encoder_state_t Encoder<PORT, PIN_A, PIN_B, VECTOR>::state;
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR>
+encoder_speed_t Encoder<PORT, PIN_A, PIN_B, VECTOR>::speed;
+
+#ifdef ENCODER_BATCHED
+	template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR>
+	encoder_queue_t Encoder<PORT, PIN_A, PIN_B, VECTOR>::queue;
+#endif
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR, class COUNTER>
+encoder_counter_t CountedEncoder<PORT, PIN_A, PIN_B, VECTOR, COUNTER>::counter;
+
+//-------------------------------------------------------------------------------------
+/** \brief This constructor sets up an encoder.
+ *  \details The channel pins are made inputs with pullup resistors, the ISR state 
+ *  block is given the current channel state, and the external interrupts for both
+ *  channels are set to fire on any logic change. The count and error count are left
+ *  alone in case another object of the same type has already set them.
+ *  @param p_serial_port A pointer to the serial port which writes debugging info. 
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR>
+Encoder<PORT, PIN_A, PIN_B, VECTOR>::Encoder (emstream* p_serial_port)
+{
+	ptr_to_serial = p_serial_port;
+	
+	// Initialize external interrupt pin pullup resistors
+	PORT::port () |= MASK_A | MASK_B;
+	
+	// Initialize external interrupt pins as inputs into AVR
+	PORT::ddr () &= ~(MASK_A | MASK_B);
+	
+	// Give the ISR the starting channel state before its interrupts are enabled
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+	{
+		state.state_old = read_state (PORT::pin ());
+		state.min_interval = ENCODER_MIN_EDGE_TICKS;
+		speed.window_count = state.count;
+		speed.window_stamp = encoder_time ();
+	}
+	
+	// Enable interrupt triggering for external pins
+	EIMSK |= (1 << PORT::int_number (PIN_A)) | (1 << PORT::int_number (PIN_B));
+	
+	// Any logic change in input pins generate an interrupt
+	PORT::eicr () |= (1 << PORT::isc_bit (PIN_A)) | (1 << PORT::isc_bit (PIN_B));
+	
+	// Encoder debugging message
+	DBG (ptr_to_serial, "Encoder constructor OK" << endl);
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Packs the two encoder channels from a pin register into a two-bit state.
+ *  @details The masks are constants, so this compiles into bit tests with no shifts.
+ *  @param   pins The value read from the input pin register
+ *  @return  Channel A in bit 1 and channel B in bit 0
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR>
+inline uint8_t Encoder<PORT, PIN_A, PIN_B, VECTOR>::read_state (uint8_t pins)
+{
+	return ((pins & MASK_A) ? 0x02 : 0) | ((pins & MASK_B) ? 0x01 : 0);
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Handles one edge; this is run from the encoder's ISR.
+ *  @details Normally the edge is decoded right away. When the driver is compiled with
+ *  @c -DENCODER_BATCHED, the pin register and a time stamp are only put in the queue,
+ *  which keeps the ISR as short as possible; @c drain() decodes them later.
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR>
+inline void Encoder<PORT, PIN_A, PIN_B, VECTOR>::isr (void)
+{
+	#ifdef ENCODER_BATCHED
+		uint8_t head = queue.head;
+		uint8_t next = (head + 1) & (ENCODER_QUEUE_SIZE - 1);
+		
+		if (next == queue.tail)
+		{
+			queue.overflows++;
+		}
+		else
+		{
+			queue.stamps[head] = encoder_time ();
+			queue.pins[head] = PORT::pin ();
+			queue.head = next;
+		}
+	#else
+		decode (PORT::pin (), encoder_time ());
+	#endif
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Decodes one edge.
+ *  @details This must be called from the ISR or with interrupts disabled. The channel
+ *  state is read from the pin register value. If it hasn't changed, the interrupt is
+ *  counted as a glitch. If it changed less than @c min_interval ticks after the last
+ *  legal edge, one of those two edges was noise: a spike in the middle of a period, 
+ *  or a bouncing or ringing edge. Both are dropped by taking the last one back, and
+ *  the next edge is decoded from the state before them, so a spike which comes and
+ *  goes leaves no trace and a bouncing edge is counted once when it settles. 
+ *  Otherwise the new state is looked up in @c ENCODER_TABLE against the previous one.
+ *  The encoder count is moved by the result, or the error count is incremented if 
+ *  the transition was illegal. Each legal edge is time stamped, and the time since 
+ *  the previous edge goes into the period ring unless the encoder has just reversed
+ *  or started moving.
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR>
+inline void Encoder<PORT, PIN_A, PIN_B, VECTOR>::decode (uint8_t pins, uint16_t now)
+{
+	uint8_t STATE = read_state (pins);
+
+	if (STATE == state.state_old)
+	{
+		state.errors.glitches++;
+		return;
+	}
+	if (state.stamped && (uint16_t)(now - state.last_edge) < state.min_interval)
+	{
+		state.errors.glitches++;
+		undo ();
+		return;
+	}
+
+	int8_t DELTA = encoder_decode (state.state_old, STATE);
+
+	// A zero from the table now means the encoder skipped a state
+	if (DELTA)
+	{
+		state.undo.delta = DELTA;
+		state.undo.state_old = state.state_old;
+		state.undo.direction = state.direction;
+		state.undo.stamped = state.stamped;
+		state.undo.reversed = state.reversed;
+		state.undo.last_edge = state.last_edge;
+		state.count += DELTA;
+		
+		// A period only means something if it's between two steps the same way. The
+		// periods from before a reversal are only forgotten at the next step, so that
+		// they're still there if the reversal is taken back
+		if (DELTA != state.direction)
+		{
+			state.direction = DELTA;
+			state.reversed = 1;
+		}
+		else if (state.stamped)
+		{
+			if (state.reversed)
+			{
+				clear_periods ();
+			}
+			
+			uint16_t period = now - state.last_edge;
+			uint8_t index = state.period_index;
+			
+			state.undo.period = state.periods[index];
+			state.period_sum += period - state.periods[index];
+			state.periods[index] = period;
+			state.period_index = (index + 1) & (ENCODER_PERIODS - 1);
+		}
+		state.last_edge = now;
+		state.stamped = 1;
+	}
+	else
+	{
+		state.undo.delta = 0;
+		record_error (now);
+	}
+
+	state.state_old = STATE;
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Takes back the last legal edge.
+ *  @details This must be called from the ISR or with interrupts disabled. The count,
+ *           channel state, direction and time stamp go back to what they were before
+ *           the edge, and its period is taken out of the ring. Only one edge can be 
+ *           taken back; after that there's nothing to undo until the next legal edge.
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR>
+void Encoder<PORT, PIN_A, PIN_B, VECTOR>::undo (void)
+{
+	int8_t delta = state.undo.delta;
+
+	if (!delta)
+	{
+		return;
+	}
+	if (delta == state.undo.direction && state.undo.stamped)
+	{
+		uint8_t index = (state.period_index - 1) & (ENCODER_PERIODS - 1);
+		
+		state.period_sum += state.undo.period - state.periods[index];
+		state.periods[index] = state.undo.period;
+		state.period_index = index;
+	}
+	state.count -= delta;
+	state.state_old = state.undo.state_old;
+	state.direction = state.undo.direction;
+	state.stamped = state.undo.stamped;
+	state.reversed = state.undo.reversed;
+	state.last_edge = state.undo.last_edge;
+	state.undo.delta = 0;
+	state.errors.glitches++;
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Adds an illegal transition to the error statistics.
+ *  @details This must be called from the ISR or with interrupts disabled. The time 
+ *  since the last legal edge is sorted into a histogram bin by counting how many times
+ *  it can be halved; if there hasn't been a recent legal edge, the last bin is used.
+ *  @param   now The time stamp of the edge which caused the illegal transition
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR>
+void Encoder<PORT, PIN_A, PIN_B, VECTOR>::record_error (uint16_t now)
+{
+	uint8_t bin = ENCODER_ERROR_BINS - 1;
+
+	if (state.stamped)
+	{
+		uint16_t interval = (now - state.last_edge) >> 4;
+		
+		for (bin = 0; interval && bin < ENCODER_ERROR_BINS - 1; bin++)
+		{
+			interval >>= 1;
+		}
+	}
+	if (state.errors.intervals[bin] < 0xFFFF)
+	{
+		state.errors.intervals[bin]++;
+	}
+	state.errors.count++;
+	state.errors.last_time = xTaskGetTickCountFromISR ();
+	state.errors.last_position = state.count;
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Forgets all the edge periods in the ring.
+ *  @details This must be called from the ISR or with interrupts disabled. An empty 
+ *           ring slot holds zero, so @c period_sum is always the sum of valid periods.
+ *           An empty ring has nothing from before a reversal in it either.
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR>
+void Encoder<PORT, PIN_A, PIN_B, VECTOR>::clear_periods (void)
+{
+	for (uint8_t index = 0; index < ENCODER_PERIODS; index++)
+	{
+		state.periods[index] = 0;
+	}
+	state.period_sum = 0;
+	state.period_index = 0;
+	state.reversed = 0;
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Copies the encoder's count and error count.
+ *  @details The copy is made with interrupts disabled so that the encoder's ISR cannot
+ *           change the 32-bit values while they are being read a byte at a time. The
+ *           memory barriers in @c ATOMIC_BLOCK also keep the compiler from using a 
+ *           stale copy, so the state block need not be declared volatile.
+ *  @return  A snapshot of the encoder's count and error count
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR>
+encoder_snapshot_t Encoder<PORT, PIN_A, PIN_B, VECTOR>::snapshot (void)
+{
+	encoder_snapshot_t snap;
+
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+	{
+		snap.count = state.count;
+		snap.errors = state.errors.count;
+	}
+	return (snap);
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Returns the current error count
+ *  @return  The number of illegal transitions the encoder has seen
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR>
+uint32_t Encoder<PORT, PIN_A, PIN_B, VECTOR>::error_count (void)
+{
+	return (snapshot ().errors);
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Copies the illegal transition statistics
+ *  @return  The error count, when and where the last error was, and the histogram
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR>
+encoder_errors_t Encoder<PORT, PIN_A, PIN_B, VECTOR>::error_stats (void)
+{
+	encoder_errors_t stats;
+
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+	{
+		stats = state.errors;
+	}
+	return (stats);
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Prints the illegal transition statistics
+ *  @details The error count and the time and count of the last error are printed on
+ *           one line and the interval histogram on the next, each bin labeled with its
+ *           upper limit in microseconds.
+ *  @param   serpt Reference to a serial port to which the printout will be printed
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR>
+void Encoder<PORT, PIN_A, PIN_B, VECTOR>::print_stats (emstream& serpt)
+{
+	encoder_errors_t stats = error_stats ();
+	uint32_t limit_us = (16UL * 1000000UL) / ENCODER_TIMER_HZ;
+
+	serpt << PMS ("errors: ") << stats.count << PMS (", glitches: ") << stats.glitches
+		  << PMS (", overflows: ") 
+		  << overflow_count () << PMS (", last at tick ") << stats.last_time
+		  << PMS (", count ") << stats.last_position << endl << PMS ("  us since edge:");
+	for (uint8_t bin = 0; bin < ENCODER_ERROR_BINS - 1; bin++)
+	{
+		serpt << PMS (" <") << (limit_us << bin) << ':' << stats.intervals[bin];
+	}
+	serpt << PMS (" more:") << stats.intervals[ENCODER_ERROR_BINS - 1] << endl;
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Sets the encoder count to 0
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR>
+void Encoder<PORT, PIN_A, PIN_B, VECTOR>::clear_count (void)
+{
+	set_count (0);
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Returns the current encoder count
+ *  @return  The encoder count
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR>
+int32_t Encoder<PORT, PIN_A, PIN_B, VECTOR>::view_count (void)
+{
+	return (snapshot ().count);
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Returns the position interpolated between edges.
+ *  @details At low speed the count only changes now and then, and a controller sees
+ *           a staircase. Between edges, the position is moved on from the count at the 
+ *           last edge by the velocity times the time since that edge. It is never 
+ *           moved a whole count, since the next edge hasn't come yet, and it isn't 
+ *           moved at all if the encoder is stopped or the velocity disagrees with the 
+ *           direction of the last edge.
+ *  @return  The position in counts, times @c ENCODER_ONE
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR>
+int32_t Encoder<PORT, PIN_A, PIN_B, VECTOR>::view_position (void)
+{
+	int32_t  count;
+	int32_t  rate;
+	uint16_t since;
+	int8_t   direction;
+	uint8_t  stamped;
+
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+	{
+		count = state.count;
+		since = encoder_time () - state.last_edge;
+		direction = state.direction;
+		stamped = state.stamped;
+		rate = speed.velocity;
+	}
+
+	int32_t position = count * ENCODER_ONE;
+	if (!stamped || since > ENCODER_STOP_TICKS || (rate > 0) != (direction > 0) 
+		|| rate == 0)
+	{
+		return (position);
+	}
+
+	// The distance moved since the edge, in counts times ENCODER_TIMER_HZ
+	uint32_t moved = (uint32_t)(rate < 0 ? -rate : rate) * since;
+	int32_t fraction = ENCODER_ONE - 1;
+	if (moved < ENCODER_TIMER_HZ)
+	{
+		fraction = (moved * ENCODER_ONE) / ENCODER_TIMER_HZ;
+	}
+	return ((direction > 0) ? position + fraction : position - fraction);
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Sets the encoder count to a specific input
+ *  @details The count at the start of the velocity window is moved by the same 
+ *           amount, so the jump isn't taken for motion by the next 
+ *           @c update_velocity().
+ * 	@param	 NEW_COUNT The new encoder count
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR>
+void Encoder<PORT, PIN_A, PIN_B, VECTOR>::set_count (int32_t NEW_COUNT)
+{
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+	{
+		speed.window_count += NEW_COUNT - state.count;
+		state.count = NEW_COUNT;
+	}
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Decodes the edges which the ISR has queued.
+ *  @details This method is only useful when the driver is compiled with 
+ *           @c -DENCODER_BATCHED; otherwise the ISR decodes every edge itself and this
+ *           does nothing. It should be run by one task, often enough that the queue
+ *           doesn't fill at the highest edge rate expected. Each edge is decoded with
+ *           interrupts off, as other tasks may be reading the state block.
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR>
+void Encoder<PORT, PIN_A, PIN_B, VECTOR>::drain (void)
+{
+	#ifdef ENCODER_BATCHED
+		uint8_t tail = queue.tail;
+		
+		while (tail != queue.head)
+		{
+			ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+			{
+				decode (queue.pins[tail], queue.stamps[tail]);
+			}
+			tail = (tail + 1) & (ENCODER_QUEUE_SIZE - 1);
+			queue.tail = tail;
+		}
+	#endif
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Returns the number of edges dropped because the edge queue was full.
+ *  @return  The overflow count, or 0 if the driver isn't compiled for batched mode
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR>
+uint16_t Encoder<PORT, PIN_A, PIN_B, VECTOR>::overflow_count (void)
+{
+	uint16_t overflows = 0;
+
+	#ifdef ENCODER_BATCHED
+		ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+		{
+			overflows = queue.overflows;
+		}
+	#endif
+	return (overflows);
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Updates the velocity estimate.
+ *  @details This method should be run by one task every few milliseconds; the time
+ *           between runs is the counting window. If the encoder moved at least 
+ *           @c ENCODER_FAST_EDGES counts in the window, the velocity is the count 
+ *           change divided by the window time, which is accurate at high speed. Below
+ *           that, too few edges arrive for counting to work and the velocity is found
+ *           from the average of the recent edge periods, or from the time since the 
+ *           last edge if that is longer, so the estimate falls off as the encoder 
+ *           slows. After @c ENCODER_STOP_TICKS with no edges the encoder is stopped.
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR>
+void Encoder<PORT, PIN_A, PIN_B, VECTOR>::update_velocity (void)
+{
+	int32_t  counts;
+	uint16_t window;
+	uint16_t since;
+	uint32_t period_sum;
+	uint8_t  periods = 0;
+	int8_t   direction;
+	int32_t  estimate = 0;
+
+	// The window is taken in the same atomic block as the count, since set_count() in
+	// another task moves both of them together
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+	{
+		uint16_t now = encoder_time ();
+		counts = state.count - speed.window_count;
+		window = now - speed.window_stamp;
+		speed.window_count = state.count;
+		speed.window_stamp = now;
+		since = now - state.last_edge;
+		direction = state.direction;
+		
+		// A stopped encoder's old periods and time stamp must not be used again
+		if (state.stamped && since > ENCODER_STOP_TICKS)
+		{
+			clear_periods ();
+			state.stamped = 0;
+		}
+		// Periods from before a reversal are kept until the next step, but not used
+		period_sum = state.period_sum;
+		for (uint8_t index = 0; index < ENCODER_PERIODS && !state.reversed; index++)
+		{
+			if (state.periods[index])
+			{
+				periods++;
+			}
+		}
+	}
+
+	// High speed: counts per window
+	if ((counts >= ENCODER_FAST_EDGES || counts <= -ENCODER_FAST_EDGES) && window)
+	{
+		estimate = (counts * (int32_t)ENCODER_TIMER_HZ) / window;
+	}
+	// Low speed: the average edge period, unless it's been even longer since an edge
+	else if (periods)
+	{
+		if ((uint32_t)since * periods > period_sum)
+		{
+			period_sum = since;
+			periods = 1;
+		}
+		estimate = (int32_t)(((uint32_t)ENCODER_TIMER_HZ * periods) / period_sum);
+		if (direction < 0)
+		{
+			estimate = -estimate;
+		}
+	}
+
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+	{
+		speed.velocity = estimate;
+	}
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Returns the most recent velocity estimate.
+ *  @return  The velocity in encoder counts per second
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR>
+int32_t Encoder<PORT, PIN_A, PIN_B, VECTOR>::velocity (void)
+{
+	int32_t estimate;
+
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+	{
+		estimate = speed.velocity;
+	}
+	return (estimate);
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Sets the glitch filter's shortest believable time between edges.
+ *  @details Edges closer together than this to the last legal edge are dropped and
+ *           counted as glitches. Setting it to 0 turns the filter off.
+ *  @param   ticks The shortest edge period in time stamp ticks of 4 us each
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR>
+void Encoder<PORT, PIN_A, PIN_B, VECTOR>::set_min_interval (uint16_t ticks)
+{
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+	{
+		state.min_interval = ticks;
+	}
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   This constructor sets up the encoder's interrupts and starts the counter.
+ *  @details The counter runs all the time; it is only read while it is active.
+ *  @param   p_serial_port A pointer to the serial port which writes debugging info
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR, class COUNTER>
+CountedEncoder<PORT, PIN_A, PIN_B, VECTOR, COUNTER>::CountedEncoder 
+	(emstream* p_serial_port) : Base (p_serial_port)
+{
+	COUNTER::start ();
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Reads the counter and the quadrature phase at the same instant.
+ *  @details The counter keeps counting with interrupts off, so it is read before and
+ *           after the pins and the whole thing is done again if it changed.
+ *  @param   edges Reference to a variable which gets the counter reading
+ *  @return  The quadrature phase, from 0 to 3
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR, class COUNTER>
+uint8_t CountedEncoder<PORT, PIN_A, PIN_B, VECTOR, COUNTER>::read_counter 
+	(uint16_t& edges)
+{
+	uint8_t pins;
+
+	do
+	{
+		edges = COUNTER::count ();
+		pins = PORT::pin ();
+	}
+	while (edges != COUNTER::count ());
+
+	return (encoder_phase (Base::read_state (pins)));
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Works out the count from the counter and the current phase.
+ *  @details This must be called with interrupts disabled while the counter is active.
+ *  @return  The encoder count
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR, class COUNTER>
+int32_t CountedEncoder<PORT, PIN_A, PIN_B, VECTOR, COUNTER>::counted (void)
+{
+	uint16_t edges;
+	uint8_t phase = read_counter (edges);
+	uint8_t rise = (counter.direction > 0) ? 1 : 3;
+	int32_t rises = (uint16_t)(edges - counter.edges);
+
+	return (counter.count + counter.direction * 4 * rises 
+			+ ((phase - rise) & 0x03) - ((counter.phase - rise) & 0x03));
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Moves the counter's reference point up to the present.
+ *  @details This is run on every velocity update, so the 16-bit counter can't roll 
+ *           over between reference points. It must be called with interrupts off.
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR, class COUNTER>
+void CountedEncoder<PORT, PIN_A, PIN_B, VECTOR, COUNTER>::rebase (void)
+{
+	int32_t count = counted ();
+
+	counter.phase = read_counter (counter.edges);
+	counter.count = count;
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Hands counting over from the external interrupts to the counter.
+ *  @details Queued edges are decoded first. An edge which came after the ISR last ran
+ *           shows up as a difference between the pins and the last decoded state, and
+ *           is added in, so the count and phase at the reference point match. The 
+ *           interrupts then stay off.
+ *  @param   direction The direction of motion, +1 or -1, from the velocity estimate
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR, class COUNTER>
+void CountedEncoder<PORT, PIN_A, PIN_B, VECTOR, COUNTER>::enter_counter 
+	(int8_t direction)
+{
+	Base::drain ();
+
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+	{
+		EIMSK &= ~INT_BITS;
+		EIFR = INT_BITS;
+		counter.phase = read_counter (counter.edges);
+		counter.count = Base::state.count 
+			+ (int8_t)((counter.phase - encoder_phase (Base::state.state_old) + 1) 
+					   & 0x03) - 1;
+		counter.direction = direction;
+		counter.active = 1;
+		counter.handovers++;
+	}
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Hands counting back from the counter to the external interrupts.
+ *  @details The ISR state block gets the count worked out from the counter and the
+ *           current channel state; the period ring is cleared, since its periods are 
+ *           old, and the interrupts are turned back on with no stale flags pending.
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR, class COUNTER>
+void CountedEncoder<PORT, PIN_A, PIN_B, VECTOR, COUNTER>::leave_counter (void)
+{
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+	{
+		Base::state.count = counted ();
+		Base::state.state_old = Base::read_state (PORT::pin ());
+		Base::state.direction = counter.direction;
+		Base::state.stamped = 0;
+		Base::clear_periods ();
+		counter.active = 0;
+		EIFR = INT_BITS;
+		EIMSK |= INT_BITS;
+	}
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Copies the count and error count.
+ *  @return  The current encoder count and the number of illegal transitions
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR, class COUNTER>
+encoder_snapshot_t CountedEncoder<PORT, PIN_A, PIN_B, VECTOR, COUNTER>::snapshot 
+	(void)
+{
+	encoder_snapshot_t snap;
+
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+	{
+		snap = Base::snapshot ();
+		if (counter.active)
+		{
+			snap.count = counted ();
+		}
+	}
+	return (snap);
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Sets the encoder count to 0
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR, class COUNTER>
+void CountedEncoder<PORT, PIN_A, PIN_B, VECTOR, COUNTER>::clear_count (void)
+{
+	set_count (0);
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Returns the encoder count, from the counter if it is active
+ *  @return  The current encoder count
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR, class COUNTER>
+int32_t CountedEncoder<PORT, PIN_A, PIN_B, VECTOR, COUNTER>::view_count (void)
+{
+	return (snapshot ().count);
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Returns the position, interpolated between edges only at low speed.
+ *  @details While the counter is active, edges come so often that the count alone is
+ *           good enough.
+ *  @return  The position in counts, times @c ENCODER_ONE
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR, class COUNTER>
+int32_t CountedEncoder<PORT, PIN_A, PIN_B, VECTOR, COUNTER>::view_position (void)
+{
+	int32_t position;
+
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+	{
+		position = counter.active ? counted () * ENCODER_ONE : Base::view_position ();
+	}
+	return (position);
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Sets the encoder count.
+ *  @details If the counter is active, its reference point is moved to the present
+ *           with the new count. The velocity window is moved by the jump from the 
+ *           counted position, since the base class's count is stale while the counter
+ *           is active.
+ *  @param   NEW_COUNT The new encoder count
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR, class COUNTER>
+void CountedEncoder<PORT, PIN_A, PIN_B, VECTOR, COUNTER>::set_count (int32_t NEW_COUNT)
+{
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+	{
+		int32_t window_count = Base::speed.window_count + NEW_COUNT - snapshot ().count;
+		
+		Base::set_count (NEW_COUNT);
+		Base::speed.window_count = window_count;
+		counter.phase = read_counter (counter.edges);
+		counter.count = NEW_COUNT;
+	}
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Updates the velocity estimate and hands counting between the interrupts
+ *           and the counter.
+ *  @details While the interrupts count, the estimate is made by 
+ *           @c Encoder::update_velocity(). While the counter counts, it is the change
+ *           in count over the window, which is long enough there to hold many counts.
+ *           The handover thresholds are far enough apart that noise in the estimate
+ *           won't make the encoder switch back and forth.
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR, class COUNTER>
+void CountedEncoder<PORT, PIN_A, PIN_B, VECTOR, COUNTER>::update_velocity (void)
+{
+	if (!counter.active)
+	{
+		Base::update_velocity ();
+		
+		int32_t estimate = Base::velocity ();
+		if (estimate >= ENCODER_HW_ENTER_CPS)
+		{
+			enter_counter (1);
+		}
+		else if (estimate <= -ENCODER_HW_ENTER_CPS)
+		{
+			enter_counter (-1);
+		}
+		return;
+	}
+
+	int32_t counts;
+	uint16_t window;
+
+	// As in the base class, the window goes with the count under the same lock
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+	{
+		uint16_t now = encoder_time ();
+		rebase ();
+		counts = counter.count - Base::speed.window_count;
+		window = now - Base::speed.window_stamp;
+		Base::speed.window_count = counter.count;
+		Base::speed.window_stamp = now;
+	}
+
+	int32_t estimate = window ? (counts * (int32_t)ENCODER_TIMER_HZ) / window : 0;
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+	{
+		Base::speed.velocity = estimate;
+	}
+
+	if (estimate < ENCODER_HW_EXIT_CPS && estimate > -ENCODER_HW_EXIT_CPS)
+	{
+		leave_counter ();
+	}
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Prints the error statistics and the state of the counter.
+ *  @param   serpt Reference to a serial port to which the printout will be printed
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR, class COUNTER>
+void CountedEncoder<PORT, PIN_A, PIN_B, VECTOR, COUNTER>::print_stats 
+	(emstream& serpt)
+{
+	Base::print_stats (serpt);
+	serpt << PMS ("  counter ");
+	if (counter.active)
+	{
+		serpt << PMS ("on");
+	}
+	else
+	{
+		serpt << PMS ("off");
+	}
+	serpt << PMS (", handovers: ") << counter.handovers << endl;
+}
+
+//-------------------------------------------------------------------------------------
+/** \brief   This overloaded operator "prints the encoder"
+ *  \details This prints the encoder's count and its error statistics. It is useful 
+ * 			 for debugging purposes.
+ *  @param   serpt Reference to a serial port to which the printout will be printed
+ *  @param   enc Reference to the encoder which is being printed
+ *  @return  A reference to the same serial device on which we write information.
+ *           This is used to string together things to write with @c << operators
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR>
+emstream& operator << (emstream& serpt, Encoder<PORT, PIN_A, PIN_B, VECTOR>& enc)
+{
+	encoder_snapshot_t snap = enc.snapshot ();
+
+	serpt << PMS ("Count: ") << snap.count << PMS (", ");
+	enc.print_stats (serpt);
+	return (serpt);
+}
+
+//-------------------------------------------------------------------------------------
+/** \brief   This overloaded operator prints an encoder which has a hardware counter.
+ *  \details Its count comes from the counter while the counter is in use, so it's 
+ *           taken from this class's @c snapshot() rather than the base class's, and
+ *           the counter's state is printed after the error statistics.
+ *  @param   serpt Reference to a serial port to which the printout will be printed
+ *  @param   enc Reference to the encoder which is being printed
+ *  @return  A reference to the same serial device on which we write information
+ */
+
+template <class PORT, uint8_t PIN_A, uint8_t PIN_B, uint8_t VECTOR, class COUNTER>
+emstream& operator << (emstream& serpt, 
+					   CountedEncoder<PORT, PIN_A, PIN_B, VECTOR, COUNTER>& enc)
+{
+	encoder_snapshot_t snap = enc.snapshot ();
+
+	serpt << PMS ("Count: ") << snap.count << PMS (", ");
+	enc.print_stats (serpt);
+	return (serpt);
+}
 
-#endif // ENCODER_DRIVER
\ No newline at end of file
+#endif // ENCODER_DRIVER
@@ -0,0 +1,265 @@
+//======================================================================================
+/** @file filters.h
+ *    This file contains small integer-only digital filters which can be chained
+ *    together, for cleaning up sensor readings. Each filter is a template whose
+ *    coefficients are template parameters, so they are fixed at compile time and cost
+ *    nothing to look up; every filter has a @c put() method which takes a new sample
+ *    and returns the filtered value.
+ *
+ *  Revisions:
+ *    @li 10-16-2026 Original file
+ *
+ *  License:
+ *    This file is copyright 2026 by its authors and released under the Lesser GNU
+ *    Public License, version 2, as the rest of this project is. It is intended for
+ *    educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//======================================================================================
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _FILTERS_H_
+#define _FILTERS_H_
+
+#include <stdint.h>                         // Standard integer types
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   This filter returns the median of the last @c N samples.
+ *  @details A spike shorter than half the window never gets through, while a step
+ *           gets through whole after half the window, unlike with an average. The
+ *           window is copied and sorted on each sample, which is quick for the small
+ *           odd windows this is meant for. Until the window has filled, the first
+ *           sample stands in for the missing ones.
+ *  @param   N The number of samples in the window; it must be odd and small
+ */
+
+template <uint8_t N>
+class median_filter
+{
+	static_assert (N & 1, "A median filter's window must hold an odd number of samples");
+
+	protected:
+		uint16_t window[N];                 ///< The most recent samples, as a ring
+		uint8_t  index;                     ///< Where the next sample goes in the ring
+		uint8_t  primed;                    ///< Nonzero once the window has been filled
+
+	public:
+		/// The constructor makes an empty filter
+		median_filter (void) : index (0), primed (0) { }
+
+		/** Puts a new sample into the window and returns the median of the window.
+		 *  @param   sample The newest sample
+		 *  @return  The median of the last @c N samples
+		 */
+		uint16_t put (uint16_t sample)
+		{
+			if (!primed)
+			{
+				for (uint8_t slot = 0; slot < N; slot++)
+				{
+					window[slot] = sample;
+				}
+				primed = 1;
+			}
+			window[index] = sample;
+			if (++index >= N)
+			{
+				index = 0;
+			}
+
+			// Insertion sort a copy; for a handful of samples nothing is faster
+			uint16_t sorted[N];
+			for (uint8_t slot = 0; slot < N; slot++)
+			{
+				uint16_t value = window[slot];
+				uint8_t place = slot;
+				for ( ; place > 0 && sorted[place - 1] > value; place--)
+				{
+					sorted[place] = sorted[place - 1];
+				}
+				sorted[place] = value;
+			}
+			return (sorted[N / 2]);
+		}
+};
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   This filter is a first order low pass (exponential moving average) whose
+ *           coefficient is a power of two.
+ *  @details Each sample moves the output 1 / 2^SHIFT of the way toward it, which takes
+ *           a subtraction, a shift and an addition. The output is kept with @c SHIFT
+ *           extra fraction bits so that small changes aren't rounded away. The time
+ *           constant is about 2^SHIFT samples. The first sample sets the output.
+ *  @param   SHIFT The base 2 logarithm of the time constant in samples, up to 15
+ */
+
+template <uint8_t SHIFT>
+class iir_filter
+{
+	static_assert (SHIFT < 16, "An IIR filter's shift must leave room in 32 bits");
+
+	protected:
+		int32_t  scaled;                    ///< The output times 2^SHIFT
+		uint8_t  primed;                    ///< Nonzero once a sample has come in
+
+	public:
+		/// The constructor makes an empty filter
+		iir_filter (void) : scaled (0), primed (0) { }
+
+		/** Puts a new sample into the filter and returns the new output.
+		 *  @param   sample The newest sample
+		 *  @return  The filtered value
+		 */
+		uint16_t put (uint16_t sample)
+		{
+			if (!primed)
+			{
+				scaled = (int32_t)sample << SHIFT;
+				primed = 1;
+			}
+			scaled += (int32_t)sample - (scaled >> SHIFT);
+			return ((uint16_t)(scaled >> SHIFT));
+		}
+};
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   This filter runs each sample through two other filters, one after the
+ *           other.
+ *  @details Longer chains are made by using a chain as one of the filters.
+ *  @param   FIRST The filter which gets each sample first
+ *  @param   SECOND The filter which gets the output of the first one
+ */
+
+template <class FIRST, class SECOND>
+class filter_chain
+{
+	protected:
+		FIRST  first;                       ///< The first filter in the chain
+		SECOND second;                      ///< The filter after it
+
+	public:
+		/** Puts a new sample through both filters.
+		 *  @param   sample The newest sample
+		 *  @return  The output of the second filter
+		 */
+		uint16_t put (uint16_t sample)
+		{
+			return (second.put (first.put (sample)));
+		}
+};
+
+/// The number of fraction bits in a signal to noise ratio from a @c baseline_filter
+#define FILTER_SNR_BITS  4
+
+/// A signal to noise ratio of one, as returned by @c baseline_filter::snr()
+#define FILTER_SNR_ONE  (1 << FILTER_SNR_BITS)
+
+//-------------------------------------------------------------------------------------
+/** @brief   This filter tracks a slowly changing background level and the noise on
+ *           it, and returns how far each sample stands above the background.
+ *  @details The baseline is a slow exponential moving average of the samples and the
+ *           noise floor is a faster one of the absolute difference between each sample
+ *           and the baseline (the mean absolute deviation, about 0.8 standard 
+ *           deviations for Gaussian noise). Both are kept with extra fraction bits. 
+ *           While a sample stands out by @c HOLD_SNR or more, the baseline and noise
+ *           floor are held, so a target in view isn't soaked up into the background.
+ *           A lasting change in room lighting looks like a signal which never goes
+ *           away, so after 2^HOLD_SHIFT samples in a row have been held, both adapt
+ *           again until the samples stop standing out. For the first 2^NOISE_SHIFT 
+ *           samples both always adapt, so the noise floor can settle first.
+ *  @param   BASE_SHIFT The baseline's time constant is about 2 to this power samples
+ *  @param   NOISE_SHIFT The noise floor's time constant is about 2 to this power 
+ *           samples
+ *  @param   HOLD_SHIFT The most samples in a row for which the background is held is
+ *           2 to this power
+ *  @param   HOLD_SNR The signal to noise ratio, times @c FILTER_SNR_ONE, at and above
+ *           which the background is held
+ */
+
+template <uint8_t BASE_SHIFT, uint8_t NOISE_SHIFT, uint8_t HOLD_SHIFT, uint16_t HOLD_SNR>
+class baseline_filter
+{
+	static_assert (BASE_SHIFT < 16 && NOISE_SHIFT < 16 && HOLD_SHIFT < 16,
+				   "Baseline filter shifts must be under 16");
+
+	protected:
+		int32_t  base_scaled;               ///< The baseline times 2^BASE_SHIFT
+		int32_t  noise_scaled;              ///< The noise floor times 2^NOISE_SHIFT
+		uint16_t warmup;                    ///< Samples left before holding can start
+		uint16_t held;                      ///< Samples held in a row
+		uint16_t last_snr;                  ///< The last sample's signal to noise ratio
+		uint8_t  primed;                    ///< Nonzero once a sample has come in
+
+	public:
+		/// The constructor makes an empty filter
+		baseline_filter (void) : base_scaled (0), noise_scaled (0), 
+			warmup (1 << NOISE_SHIFT), held (0), last_snr (0), primed (0) { }
+
+		/** Puts a new sample into the filter.
+		 *  @param   sample The newest sample
+		 *  @return  How far the sample is above the baseline, or 0 if it's below
+		 */
+		uint16_t put (uint16_t sample)
+		{
+			if (!primed)
+			{
+				base_scaled = (int32_t)sample << BASE_SHIFT;
+				primed = 1;
+			}
+
+			int16_t deviation = (int16_t)sample - (int16_t)(base_scaled >> BASE_SHIFT);
+			int16_t magnitude = (deviation < 0) ? -deviation : deviation;
+
+			// The noise floor is kept at a quarter count or more, so a perfectly steady
+			// input doesn't give enormous ratios
+			int32_t noise = noise_scaled;
+			if (noise < (1L << NOISE_SHIFT) / 4)
+			{
+				noise = (1L << NOISE_SHIFT) / 4;
+			}
+			uint32_t snr = 0;
+			if (deviation > 0)
+			{
+				snr = ((uint32_t)deviation << (FILTER_SNR_BITS + NOISE_SHIFT)) / noise;
+			}
+			last_snr = (snr > 0xFFFF) ? 0xFFFF : snr;
+
+			if (last_snr < HOLD_SNR)
+			{
+				held = 0;
+			}
+			else if (!warmup && held < (1U << HOLD_SHIFT))
+			{
+				held++;
+				return (deviation);
+			}
+
+			base_scaled += deviation;
+			noise_scaled += magnitude - (noise_scaled >> NOISE_SHIFT);
+			if (warmup)
+			{
+				warmup--;
+			}
+
+			return ((deviation > 0) ? deviation : 0);
+		}
+
+		/// Returns the last sample's signal to noise ratio times @c FILTER_SNR_ONE
+		uint16_t snr (void) { return (last_snr); }
+
+		/// Returns the baseline, in the same units as the samples
+		uint16_t baseline (void) { return ((uint16_t)(base_scaled >> BASE_SHIFT)); }
+};
+
+#endif // _FILTERS_H_
@@ -80,48 +80,31 @@ TextQueue* p_print_ser_queue;
 TaskShare<int16_t>* p_share_1;
 TaskShare<int16_t>* p_share_2;
 
-// This shared data item is used to set the motor mode: power, brake, freewheel for motors
-// 1 and 2. Motor 1 uses integers 0 through 2 and motor 2 uses integers 3 through 5.
-TaskShare<uint8_t>* p_mode;
+// These shared data items are used to set the motor modes: power, brake, freewheel for
+// motors 1 and 2. Motor 1 uses integers 0 through 2 and motor 2 uses integers 3 through
+// 5, each in its own share so that both motors can be commanded at the same time.
+TaskShare<uint8_t>* p_mode_1;
+TaskShare<uint8_t>* p_mode_2;
+
+// This shared data item holds the time stamp, from encoder_time (), at which 
+// task_control read the encoders for the commands it last published
+TaskShare<uint16_t>* p_control_time;
+
+// These shared data items hold the latest and longest time in microseconds from the
+// encoders being read to task_motor applying the commands worked out from them
+TaskShare<uint16_t>* p_latency;
+TaskShare<uint16_t>* p_latency_max;
+
+// With -DCONTROL_TIMER, this shared data item holds the largest difference in 
+// microseconds between the time from one control update to the next and the period
+#ifdef CONTROL_TIMER
+	TaskShare<uint16_t>* p_jitter_max;
+#endif
 
 // This shared data item is used to read the state of the encoder tick used for comparison 
 // in the ISR.
 TaskShare<uint8_t>* p_state;
 
-// This shared data item is used to hold the state of the last encoder tick from encoder 1 used for 
-// comparison in the ISR.
-TaskShare<uint8_t>* p_state_old_1;
-
-// This shared data item is used to hold the state of the last encoder tick from encoder 2 used for 
-// comparison in the ISR.
-TaskShare<uint8_t>* p_state_old_2;
-
-// This shared data item is used to hold the count for current number of errors. This number 
-// is incremented in the ISR when applicable and read using error_count method.
-TaskShare<uint32_t>* p_error_cntr;
-
-// This shared data item is used to hold the count for current position of encoder 1. This number 
-// is incremented or decremented based on comparsion of current and old states in the ISR and 
-// read using view_count method.
-TaskShare<uint32_t>* p_encoder_cntr_1;
-
-// This shared data item is used to hold the count for current position of encoder 2. This number 
-// is incremented or decremented based on comparsion of current and old states in the ISR and 
-// read using view_count method.
-TaskShare<uint32_t>* p_encoder_cntr_2;
-
-// This shared data is used to hold the location of channel A external interrupt pin.
-TaskShare<uint8_t>* p_ext_pin_A;
-
-// This shared data is used to hold the location of channel B external interrupt pin.
-TaskShare<uint8_t>* p_ext_pin_B;
-
-// This shared data is used to hold the location of channel C external interrupt pin.
-TaskShare<uint8_t>* p_ext_pin_C;
-
-// This shared data is used to hold the location of channel D external interrupt pin.
-TaskShare<uint8_t>* p_ext_pin_D;
-
 // This shared data item is used to hold the position of motor 1 sent to the control loop
 TaskShare<int16_t>* p_position_1;
 
@@ -131,17 +114,27 @@ TaskShare<int16_t>* p_position_2;
 // This shared data item is used to signal task_trigger to pull the gun's trigger
 TaskShare<bool>* fire_at_will;
 
-// These are shared data items to read the IR sensors
-TaskShare<uint16_t>* p_high_left;
-TaskShare<uint16_t>* p_high_right;
-TaskShare<uint16_t>* p_center;
-TaskShare<uint16_t>* p_low_left;
-TaskShare<uint16_t>* p_low_right;
+// This double buffer holds the newest frame of IR sensor readings, each sensor's 
+// reading above ambient light and signal to noise ratio from the same scan
+double_buffer<sensor_frame_t>* p_sensor_frame;
 
 // These are shared data items that signal when a particular motor's control loop has 
 // reached the desired value
 TaskShare <bool>* p_pos_done_1;
 TaskShare <bool>* p_pos_done_2;
+
+// These shared data items hold the time in milliseconds until each axis's motion 
+// profile arrives at the reference position it was last given
+TaskShare<uint16_t>* p_eta_1;
+TaskShare<uint16_t>* p_eta_2;
+
+// This is the A/D converter driver, shared by every task which reads the converter
+adc* p_adc;
+
+// These are the motor drivers; p_motor_1 drives the gun angle and p_motor_2 the base.
+// They're used by task_motor, or with -DCONTROL_TIMER by task_control directly
+Motor* p_motor_1;
+Motor* p_motor_2;
 //=====================================================================================
 /** The main function sets up the RTOS.  Some test tasks are created. Then the 
  *  scheduler is started up; the scheduler runs until power is turned off or there's a 
@@ -169,53 +162,77 @@ int main (void)
  	// Create shared variables for motor control
 	p_share_1 = new TaskShare<int16_t> ("Speed_1");
 	p_share_2 = new TaskShare<int16_t> ("Speed_2");
-	p_mode = new TaskShare<uint8_t> ("Mode");
+	p_mode_1 = new TaskShare<uint8_t> ("Mode_1");
+	p_mode_2 = new TaskShare<uint8_t> ("Mode_2");
+	p_control_time = new TaskShare<uint16_t> ("Ctl_time");
+	p_latency = new TaskShare<uint16_t> ("Latency_us");
+	p_latency_max = new TaskShare<uint16_t> ("Lat_max_us");
+	#ifdef CONTROL_TIMER
+		p_jitter_max = new TaskShare<uint16_t> ("Jitter_us");
+	#endif
 	p_state= new TaskShare<uint8_t> ("State");
 	
-	// Create shared variables for encoder states and positions
-	p_state_old_1= new TaskShare<uint8_t> ("StateOld_1");
-	p_state_old_2= new TaskShare<uint8_t> ("StateOld_2");
+	// Create shared variables for the reference positions
 	p_position_1= new TaskShare<int16_t> ("Pos_1");
 	p_position_2= new TaskShare<int16_t> ("Pos_2");
 	
-	// Create shared variables for encoder counters
-	p_encoder_cntr_1= new TaskShare<uint32_t> ("EncoderCntr_1");
-	p_encoder_cntr_2= new TaskShare<uint32_t> ("EncoderCntr_2");
-	p_error_cntr= new TaskShare<uint32_t> ("ErrorCntr");
-	
-	// Create shared variables for the encoder external interrupt pins
-	p_ext_pin_A= new TaskShare<uint8_t> ("ExtPinA");
-	p_ext_pin_B= new TaskShare<uint8_t> ("ExtPinB");
-	p_ext_pin_C= new TaskShare<uint8_t> ("ExtPinC");
-	p_ext_pin_D= new TaskShare<uint8_t> ("ExtPinD");
-	
 	// Create shared variable for the trigger
 	fire_at_will = new TaskShare<bool> ("Shoot_em_up");
 	
-//  Create shared variable for the phototransistor sensor readings
-	p_high_left= new TaskShare<uint16_t> ("P_high_L"); 
-	p_high_right= new TaskShare<uint16_t> ("P_high_R"); 
-	p_center= new TaskShare<uint16_t> ("P_center"); 
-	p_low_left= new TaskShare<uint16_t> ("P_low_L"); 
-	p_low_right= new TaskShare<uint16_t> ("P_low_R"); 
+//  Create the double buffer for frames of phototransistor sensor readings
+	p_sensor_frame = new double_buffer<sensor_frame_t>;
 
 	// Create shared variables for signaling when a desired position has been reached
 	p_pos_done_1 = new TaskShare <bool> ("Pos_done_1");
 	p_pos_done_2 = new TaskShare <bool> ("Pos_done_2");
 	
+	// Create shared variables for the time until each axis's profile arrives
+	p_eta_1 = new TaskShare<uint16_t> ("ETA_1_ms");
+	p_eta_2 = new TaskShare<uint16_t> ("ETA_2_ms");
+	
+	// Create the one A/D converter driver; its request queues are made here too
+	p_adc = new adc (p_ser_port);
+	
+	// Create the motor drivers, which must be ready before any task can command them
+	p_motor_1 = new Motor (p_ser_port, &PORTC, &DDRC, 0, &PORTC, &DDRC, 1, &PORTC,
+						   &DDRC, 2, &PORTB, &DDRB, 6, &OCR1B);
+	p_motor_2 = new Motor (p_ser_port, &PORTD, &DDRD, 5, &PORTD, &DDRD, 6, &PORTD,
+						   &DDRD, 7, &PORTB, &DDRB, 5, &OCR1A);
+	
+	// These lines configure 8-bit fast PWM for both motors on timer 1. The CS11 and
+	// CS10 bits set the prescaler for this timer/counter to run it at F_CPU / 64
+	TCCR1A |= (1 << WGM10)
+			 | (1 << COM1A1) | (1 << COM1B1);
+	TCCR1A &= ~(1 << COM1A0) & ~(1 << COM1B0);
+	TCCR1B |= (1 << WGM12)
+			 | (1 << CS11)  | (1 << CS10);
+	
 	// The user interface is at low priority; it is only used to print debugging messages
 	// and restart the microcontroller in this application
 	new task_user ("UserInt", task_priority (0), 260, p_ser_port);
 
-	// Create a task which outputs to a motor driver
-	new task_motor ("Motor", task_priority (2), 280, p_ser_port);
+	// Create a task which outputs to a motor driver. When the control loop is run by
+	// timer 2, it drives the motors itself and this task isn't needed
+	#ifndef CONTROL_TIMER
+		new task_motor ("Motor", task_priority (2), 280, p_ser_port);
+	#endif
 	
-	// Create a task which monitors the activity of the optical encoders
-	new task_encoder ("Encoder", task_priority (1), 280, p_ser_port);
+	// Create a task which monitors the activity of the optical encoders. In batched mode
+	// it decodes every edge, so it must run ahead of the tasks which use the counts
+	#ifdef ENCODER_BATCHED
+		new task_encoder ("Encoder", task_priority (4), 280, p_ser_port);
+	#else
+		new task_encoder ("Encoder", task_priority (1), 280, p_ser_port);
+	#endif
 	
 	// Create a task which utilized the motor and encoder tasks to provide closed-loop
-	// control of a motor
-	new task_control ("Controller", task_priority (3), 280, p_ser_port);
+	// control of a motor. When timer 2 wakes it, it must outrank every task which it
+	// could interrupt, so task_position moves below it
+	#ifdef CONTROL_TIMER
+		new task_control ("Controller", task_priority (4), 280, p_ser_port);
+	#else
+		new task_control ("Controller", task_priority (3), 280, p_ser_port);
+	#endif
 	
 	// Create a task to scan a bank of phototransistors using an A/D converter
 	new task_sensor ("Sensor", task_priority (1), 280, p_ser_port);
@@ -224,7 +241,11 @@ int main (void)
 	new task_trigger ("Trigger", task_priority (0), 280, p_ser_port);
 	
 	// Create a task to determine the current motors' positions
-	new task_position ("Position", task_priority (4), 280, p_ser_port);
+	#ifdef CONTROL_TIMER
+		new task_position ("Position", task_priority (3), 280, p_ser_port);
+	#else
+		new task_position ("Position", task_priority (4), 280, p_ser_port);
+	#endif
 	
 	// Here's where the RTOS scheduler is started up. It should never exit as long as
 	// power is on and the microcontroller isn't rebooted
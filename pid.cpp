@@ -0,0 +1,505 @@
+//======================================================================================
+/** @file pid.cpp
+ *    This file contains a PID controller which uses only integer arithmetic, and a
+ *    benchmark which compares it with the same controller in floating point.
+ *
+ *  Revisions:
+ *    @li 10-16-2026 Original file
+ *    @li 10-16-2026 Real integral with anti-windup, filtered derivative, bumpless gains
+ *
+ *  License:
+ *    This file is copyright 2026 by its authors and released under the Lesser GNU
+ *    Public License, version 2, as the rest of this project is. It is intended for
+ *    educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//======================================================================================
+
+#include <stdlib.h>                         // Include standard library header files
+#include <avr/io.h>
+
+#include "pid.h"                            // Header for this controller
+
+/// The largest number a 32 bit product or sum can hold
+#define PID_PRODUCT_MAX  0x7FFFFFFFL
+
+/** The number of the error's fraction bits kept in the products. A sixteenth of a 
+ *  count is far finer than the motors can respond to, and dropping the other bits 
+ *  leaves room in 32 bits for large errors. */
+#define PID_KEPT_BITS  4
+
+/// The number of fraction bits in each term and in the sum of the terms
+#define PID_SUM_BITS  (PID_GAIN_BITS + PID_KEPT_BITS)
+
+/** The number of fraction bits in the integral. The steps added at a thousand updates
+ *  a second are tiny, so it keeps four more than the other terms. */
+#define PID_INTEGRAL_BITS  (PID_SUM_BITS + 4)
+
+/** The fraction bits of the integral gain times the update period, less its shift; 
+ *  with these, its product with an error has the integral's fraction bits. */
+#define PID_KI_DT_BITS  (PID_INTEGRAL_BITS - PID_KEPT_BITS)
+
+/** The most the product of the error and the integral gain times the update period is
+ *  shifted down. Tiny gains at high rates still keep 15 bits with this. */
+#define PID_KI_DT_SHIFT_MAX  24
+
+/// The largest output which the integral can hold with its fraction bits in 32 bits
+#define PID_INTEGRAL_OUTPUT_MAX  (PID_PRODUCT_MAX >> PID_INTEGRAL_BITS)
+
+
+//-------------------------------------------------------------------------------------
+/** This function adds two numbers, giving the largest or smallest 32 bit number
+ *  instead of wrapping around if the sum doesn't fit.
+ *  @param   first One of the numbers
+ *  @param   second The other number
+ *  @return  The sum, saturated
+ */
+
+static int32_t add_saturated (int32_t first, int32_t second)
+{
+	if (second > 0 && first > PID_PRODUCT_MAX - second)
+	{
+		return (PID_PRODUCT_MAX);
+	}
+	if (second < 0 && first < -PID_PRODUCT_MAX - second)
+	{
+		return (-PID_PRODUCT_MAX);
+	}
+	return (first + second);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function keeps a number from -limit to limit.
+ *  @param   value The number
+ *  @param   limit The largest magnitude allowed, which must not be negative
+ *  @return  The number, limited
+ */
+
+static int32_t clamp (int32_t value, int32_t limit)
+{
+	if (value > limit)
+	{
+		return (limit);
+	}
+	if (value < -limit)
+	{
+		return (-limit);
+	}
+	return (value);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function multiplies an input by a gain after limiting the input, so that the
+ *  product can't overflow.
+ *  @param   input The input, an error or a rate
+ *  @param   gain The gain
+ *  @param   input_max The largest input whose product with the gain fits
+ *  @return  The product
+ */
+
+static int32_t multiply_saturated (int32_t input, int16_t gain, int32_t input_max)
+{
+	return (clamp (input, input_max) * gain);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function finds the largest input whose product with a gain fits in 32 bits.
+ *  @param   gain The gain
+ *  @param   shift How many bits the product is shifted left afterwards
+ *  @return  The largest input which can be multiplied by the gain
+ */
+
+static int32_t input_limit (int16_t gain, uint8_t shift)
+{
+	if (gain == 0)
+	{
+		return (PID_PRODUCT_MAX);
+	}
+	return ((PID_PRODUCT_MAX >> shift) / abs (gain));
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function cuts a sum of terms down to an integer, toward zero.
+ *  @param   sum The sum, with @c PID_SUM_BITS fraction bits
+ *  @return  The integer part of the sum
+ */
+
+static int32_t whole_part (int32_t sum)
+{
+	// Shifting a negative number rounds it down, so it's done to the magnitude
+	return ((sum < 0) ? -(-sum >> PID_SUM_BITS) : (sum >> PID_SUM_BITS));
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This constructor makes a PID controller. The update period and the derivative
+ *  filter's time constant are worked out from the rate here, with divisions, so 
+ *  @c update() needs none.
+ *  @param   a_kp The proportional gain, made with @c PID_GAIN()
+ *  @param   a_ki The integral gain per second, made with @c PID_GAIN()
+ *  @param   a_kd The derivative gain, made with @c PID_GAIN()
+ *  @param   a_rate_hz How many times a second @c update() is run; 0 is taken as 1
+ *  @param   a_output_max The output is kept from -a_output_max to a_output_max
+ *           (default: 32767)
+ *  @param   a_d_filter_ms The rough time constant of the low pass filter on the rate
+ *           in milliseconds; it's rounded down to a power of two updates, up to
+ *           @c PID_D_SHIFT_MAX, and 0 turns the filter off (default: 0)
+ */
+
+pid::pid (int16_t a_kp, int16_t a_ki, int16_t a_kd, uint16_t a_rate_hz, 
+		  int16_t a_output_max, uint16_t a_d_filter_ms)
+{
+	output_max = a_output_max;
+	integral_max = (int32_t)((output_max < PID_INTEGRAL_OUTPUT_MAX) 
+							 ? output_max : PID_INTEGRAL_OUTPUT_MAX) 
+				   << PID_INTEGRAL_BITS;
+
+	rate_hz = a_rate_hz ? a_rate_hz : 1;
+
+	uint32_t filter_updates = (uint32_t)a_d_filter_ms * rate_hz / 1000;
+	d_shift = 0;
+	while (d_shift < PID_D_SHIFT_MAX && (2UL << d_shift) <= filter_updates)
+	{
+		d_shift++;
+	}
+
+	// With no gains yet, set_gains() has no terms to keep the output level with
+	kp = 0;
+	ki = 0;
+	kd = 0;
+	p_input_max = PID_PRODUCT_MAX;
+	d_input_max = PID_PRODUCT_MAX;
+	reset ();
+	set_gains (a_kp, a_ki, a_kd);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method works out the sum of the proportional and derivative terms for the
+ *  inputs to the last update, with the gains as they are now.
+ *  @return  The sum of the two terms, with @c PID_SUM_BITS fraction bits
+ */
+
+int32_t pid::last_pd (void)
+{
+	return (add_saturated (multiply_saturated (error_old, kp, p_input_max),
+						   -(multiply_saturated (rate_old, kd, d_input_max)
+							 << PID_KEPT_BITS)));
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method changes the controller's gains, and works out the largest input which
+ *  can be multiplied by each one. It takes a few divisions, so it shouldn't be run
+ *  each time through a control loop. The change is bumpless: the integral takes up
+ *  the difference which the new proportional and derivative gains make to the last
+ *  output, so the output only moves as the error and rate do.
+ *  @param   a_kp The proportional gain, made with @c PID_GAIN()
+ *  @param   a_ki The integral gain per second, made with @c PID_GAIN()
+ *  @param   a_kd The derivative gain, made with @c PID_GAIN()
+ */
+
+void pid::set_gains (int16_t a_kp, int16_t a_ki, int16_t a_kd)
+{
+	int32_t pd_before = last_pd ();
+
+	kp = a_kp;
+	ki = a_ki;
+	kd = a_kd;
+	p_input_max = input_limit (kp, 0);
+	d_input_max = input_limit (kd, PID_KEPT_BITS);
+
+	// The integral gain over the rate is found with PID_KI_DT_BITS plus a shift of 
+	// fraction bits, starting where a gain of 4 at 1 Hz fits and adding bits while 
+	// the result stays under 32768; the products can't overflow 32 bits
+	const uint32_t KI_DT_LIMIT = 0x7FFFUL * rate_hz;
+	uint32_t scaled = abs (ki);
+	int8_t shift = PID_GAIN_BITS - PID_KI_DT_BITS;
+	while (shift < PID_KI_DT_SHIFT_MAX && (scaled << 1) <= KI_DT_LIMIT)
+	{
+		scaled <<= 1;
+		shift++;
+	}
+	uint32_t magnitude = (scaled + rate_hz / 2) / rate_hz;
+	if (magnitude > 0x7FFF)
+	{
+		magnitude = 0x7FFF;
+	}
+	ki_dt = (ki < 0) ? -(int16_t)magnitude : (int16_t)magnitude;
+	ki_dt_shift = shift;
+	i_input_max = input_limit (ki_dt, (shift < 0) ? -shift : 0);
+
+	// The difference is limited first so that shifting it to the integral's bits
+	// can't overflow; the integral can't hold more than that anyway
+	int32_t jump = clamp (add_saturated (pd_before, -last_pd ()),
+						  integral_max >> (PID_INTEGRAL_BITS - PID_SUM_BITS));
+	integral = clamp (add_saturated (integral, 
+									 jump << (PID_INTEGRAL_BITS - PID_SUM_BITS)),
+					  integral_max);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method forgets the integral, the last error and the filtered rate, so the
+ *  controller starts again as if it had just been made.
+ */
+
+void pid::reset (void)
+{
+	integral = 0;
+	error_old = 0;
+	rate_old = 0;
+	rate_scaled = 0;
+	primed = 0;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method runs the controller once. The rate is filtered, then the proportional
+ *  and derivative terms and the command fed forward are added without rounding. The
+ *  integral gain times the error times the update period is added to the integral,
+ *  but only as far as puts the output at its limit, and not at all if it's already 
+ *  there. The sum of it all is cut down to an integer toward zero, then limited to 
+ *  the largest output. The feed-forward must be given here rather than added to the
+ *  output afterward, or the integral would keep winding up while the motor is 
+ *  already at full command.
+ *  @param   error The error, with @c PID_ERROR_BITS fraction bits
+ *  @param   rate How fast the measured value is changing, in whole units per second
+ *  @param   feed_forward A command added to the output, in output units (default 0)
+ *  @return  The output, from -output_max to output_max
+ */
+
+int16_t pid::update (int32_t error, int32_t rate, int16_t feed_forward)
+{
+	// The error is rounded to the bits kept rather than shifted down, which would 
+	// always round it down; at a few updates a second the integral would drift
+	error = add_saturated (error, 1L << (PID_ERROR_BITS - PID_KEPT_BITS - 1)) 
+			>> (PID_ERROR_BITS - PID_KEPT_BITS);
+
+	// The filter starts at the first rate rather than ramping up from zero
+	if (!primed)
+	{
+		rate_scaled = rate << d_shift;
+		primed = 1;
+	}
+	rate_scaled += rate - (rate_scaled >> d_shift);
+	rate = rate_scaled >> d_shift;
+
+	error_old = error;
+	rate_old = rate;
+	int32_t sum = add_saturated (last_pd (), clamp (feed_forward, PID_PRODUCT_MAX 
+											 >> PID_SUM_BITS) << PID_SUM_BITS);
+
+	// The step is the integral gain times the update period times the error, shifted
+	// to the integral's fraction bits
+	int32_t step = multiply_saturated (error, ki_dt, i_input_max);
+	step = (ki_dt_shift < 0) ? (step << -ki_dt_shift) : (step >> ki_dt_shift);
+
+	// A step toward a limit is cut off where the whole output, feed-forward and all,
+	// reaches it; an integral which is already past that isn't pulled back
+	int32_t limit = clamp (output_max, PID_PRODUCT_MAX >> PID_SUM_BITS) << PID_SUM_BITS;
+	int32_t room = clamp (add_saturated ((step > 0) ? limit : -limit, -sum),
+						  integral_max >> (PID_INTEGRAL_BITS - PID_SUM_BITS))
+				   << (PID_INTEGRAL_BITS - PID_SUM_BITS);
+	int32_t stepped = add_saturated (integral, step);
+	if (step > 0 && stepped > room)
+	{
+		stepped = (integral > room) ? integral : room;
+	}
+	else if (step < 0 && stepped < room)
+	{
+		stepped = (integral < room) ? integral : room;
+	}
+	integral = clamp (stepped, integral_max);
+
+	int32_t output = whole_part (add_saturated (sum, integral 
+										>> (PID_INTEGRAL_BITS - PID_SUM_BITS)));
+	return ((int16_t)clamp (output, output_max));
+}
+
+
+#ifdef PID_BENCH
+
+#include <util/atomic.h>
+
+#include "encoder_driver.h"                 // The clock which updates are timed with
+
+/// The number of controller updates timed for each measurement
+#define PID_BENCH_RUNS  64
+
+/// The settings used by @c task_control for the gun motor, which are benchmarked
+#define PID_BENCH_KP   0.6
+#define PID_BENCH_KI   1.0
+#define PID_BENCH_KD   0.01
+#define PID_BENCH_MAX  300
+
+/// The update rate, @c task_control's default, and the derivative filter's time 
+/// constant of four updates
+#define PID_BENCH_HZ   100
+#define PID_BENCH_FILTER_MS  40
+#define PID_BENCH_FILTER_UPDATES  4
+
+/// The inputs are kept here so the compiler can't work the results out in advance
+static volatile int32_t bench_error;
+static volatile int32_t bench_rate;
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   This class is the same controller as class @c pid, with the benchmark's
+ *           settings, in floating point, for comparison.
+ */
+
+class float_pid
+{
+	protected:
+		double integral;                    ///< The integral term
+		double rate_filtered;               ///< The filtered rate
+		bool   primed;                      ///< True once the filter has a rate
+
+	public:
+		/// The constructor makes a controller with an empty integral
+		float_pid (void) : integral (0.0), rate_filtered (0.0), primed (false) { }
+
+		/** Runs the controller once, as @c pid::update() does.
+		 *  @param   error The error, with @c PID_ERROR_BITS fraction bits
+		 *  @param   rate The rate in units per second
+		 *  @return  The output, cut down to an integer toward zero
+		 */
+		int16_t update (int32_t error, int32_t rate)
+		{
+			if (!primed)
+			{
+				rate_filtered = rate;
+				primed = true;
+			}
+			rate_filtered += (rate - rate_filtered) / PID_BENCH_FILTER_UPDATES;
+
+			double counts = (double)error / (1 << PID_ERROR_BITS);
+			double sum = counts * PID_BENCH_KP - rate_filtered * PID_BENCH_KD;
+			double step = counts * PID_BENCH_KI / PID_BENCH_HZ;
+			double room = ((step > 0) ? PID_BENCH_MAX : -PID_BENCH_MAX) - sum;
+			double stepped = integral + step;
+			if (step > 0 && stepped > room)
+			{
+				stepped = (integral > room) ? integral : room;
+			}
+			else if (step < 0 && stepped < room)
+			{
+				stepped = (integral < room) ? integral : room;
+			}
+			integral = stepped;
+			if (integral > PID_BENCH_MAX)
+			{
+				integral = PID_BENCH_MAX;
+			}
+			else if (integral < -PID_BENCH_MAX)
+			{
+				integral = -PID_BENCH_MAX;
+			}
+			int32_t output = (int32_t)(sum + integral);
+			if (output > PID_BENCH_MAX)
+			{
+				output = PID_BENCH_MAX;
+			}
+			else if (output < -PID_BENCH_MAX)
+			{
+				output = -PID_BENCH_MAX;
+			}
+			return ((int16_t)output);
+		}
+};
+
+
+//-------------------------------------------------------------------------------------
+/** This function runs the PID benchmark and prints the results. It first times
+ *  @c PID_BENCH_RUNS updates of the floating point controller and of the fixed point
+ *  one with @c encoder_time(), and prints the processor cycles each one took. Each 
+ *  update is timed on its own with interrupts off, since the clock is only right if 
+ *  the RTOS tick is held off for under half a tick; the time to read the clock is
+ *  measured the same way and taken out. The clock counts every 64 cycles, so one
+ *  update's time is only good to a count, but the average of many is closer. Then it
+ *  feeds both the same inputs, errors from -300 to 300 counts and rates from -5000 to
+ *  5000 counts per second, and prints the largest difference between their outputs;
+ *  the gains are rounded to steps of 1 / 8192 and the errors to a sixteenth of a 
+ *  count, so they can differ by a count or two.
+ *  @param   p_ser A pointer to the serial device on which results are printed
+ */
+
+void pid_bench_run (emstream* p_ser)
+{
+	pid controller (PID_GAIN (PID_BENCH_KP), PID_GAIN (PID_BENCH_KI),
+					PID_GAIN (PID_BENCH_KD), PID_BENCH_HZ, PID_BENCH_MAX, 
+					PID_BENCH_FILTER_MS);
+	float_pid reference;
+	volatile int16_t output;
+	uint16_t start;
+	uint32_t empty_ticks = 0;
+	uint32_t float_ticks = 0;
+	uint32_t fixed_ticks = 0;
+
+	bench_error = 123L << PID_ERROR_BITS;
+	bench_rate = -2345;
+	for (uint8_t run = 0; run < PID_BENCH_RUNS; run++)
+	{
+		ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+		{
+			start = encoder_time ();
+			empty_ticks += (uint16_t)(encoder_time () - start);
+		}
+		ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+		{
+			start = encoder_time ();
+			output = reference.update (bench_error, bench_rate);
+			float_ticks += (uint16_t)(encoder_time () - start);
+		}
+		ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+		{
+			start = encoder_time ();
+			output = controller.update (bench_error, bench_rate);
+			fixed_ticks += (uint16_t)(encoder_time () - start);
+		}
+	}
+	(void)output;
+
+	float_ticks = (float_ticks > empty_ticks) ? float_ticks - empty_ticks : 0;
+	fixed_ticks = (fixed_ticks > empty_ticks) ? fixed_ticks - empty_ticks : 0;
+	*p_ser << PMS ("PID benchmark, ") << PID_BENCH_RUNS << PMS (" updates") << endl
+		   << PMS ("Float: ")
+		   << (uint16_t)((float_ticks * (F_CPU / ENCODER_TIMER_HZ)) / PID_BENCH_RUNS)
+		   << PMS (" cycles/update") << endl << PMS ("Fixed: ")
+		   << (uint16_t)((fixed_ticks * (F_CPU / ENCODER_TIMER_HZ)) / PID_BENCH_RUNS)
+		   << PMS (" cycles/update") << endl;
+
+	// Both controllers get the same inputs, each error following the last as in a loop
+	int16_t worst = 0;
+	float_pid compared;
+	controller.reset ();
+	for (int16_t counts = -300; counts <= 300; counts += 3)
+	{
+		for (int16_t rate = -5000; rate <= 5000; rate += 1250)
+		{
+			int32_t error = ((int32_t)counts << PID_ERROR_BITS) + rate / 16;
+			int16_t difference = controller.update (error, rate)
+								 - compared.update (error, rate);
+			if (abs (difference) > worst)
+			{
+				worst = abs (difference);
+			}
+		}
+	}
+	*p_ser << PMS ("Largest difference from float: ") << worst << endl;
+}
+
+#endif // PID_BENCH
@@ -0,0 +1,134 @@
+//======================================================================================
+/** @file pid.h
+ *    This file contains the header for a PID controller which uses only integer
+ *    arithmetic. The AVR has no floating point hardware, so each floating point
+ *    multiplication or addition is a library call taking a hundred or more cycles;
+ *    this controller's gains are fixed point numbers instead, and every product and
+ *    sum saturates rather than overflowing.
+ *
+ *  Revisions:
+ *    @li 10-16-2026 Original file
+ *    @li 10-16-2026 Real integral with anti-windup, filtered derivative, bumpless gains
+ *
+ *  License:
+ *    This file is copyright 2026 by its authors and released under the Lesser GNU
+ *    Public License, version 2, as the rest of this project is. It is intended for
+ *    educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//======================================================================================
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _PID_H_
+#define _PID_H_
+
+#include <stdint.h>                         // Standard integer types
+
+#include "emstream.h"                       // Header for serial ports and devices
+
+/// The number of fraction bits in a gain; gains can be from -3.99 to 3.99
+#define PID_GAIN_BITS       13
+
+/// The number of fraction bits in the errors given to the controller
+#define PID_ERROR_BITS      8
+
+/// The most the derivative filter's shift can be, a time constant of 256 updates
+#define PID_D_SHIFT_MAX     8
+
+/** This macro turns a gain into its fixed point form, rounded to the nearest step of
+ *  1 / 8192. Given a constant, the compiler works it out, so no floating point code
+ *  is made. */
+#define PID_GAIN(k)  ((int16_t)((k) * (1L << PID_GAIN_BITS) + (((k) < 0) ? -0.5 : 0.5)))
+
+//-------------------------------------------------------------------------------------
+/** @brief   This class is a PID controller whose arithmetic is all fixed point.
+ *  @details The error has @c PID_ERROR_BITS fraction bits, as the interpolated encoder
+ *           positions do, and the rate is in whole units per second. Each term is a
+ *           32 bit product with @c PID_GAIN_BITS plus four fraction bits, so the 
+ *           terms are added up without rounding, and the sum is cut down to an
+ *           integer once, toward zero, as the conversion of a @c double to an 
+ *           integer does. Before each multiplication the input is limited to the
+ *           largest value whose product fits in 32 bits, worked out when the gains are
+ *           set, so a huge error gives the largest output rather than a wrapped one.
+ *           Each term can reach about +/-16000 before saturating, far past what the
+ *           motors take.
+ *
+ *           The integral is kept as the integral term itself, in output units with
+ *           four more fraction bits, and each update adds the integral gain (per
+ *           second) times the error times the update period. The gain and the 
+ *           period are multiplied together when the gains are set, into 16 bits and
+ *           a shift which keeps as many bits as fit, so the step is as exact at 1000
+ *           updates a second as at 10 and takes one multiplication. The integral
+ *           never goes past the largest output, and it's only moved toward a limit
+ *           until the output, including any command fed forward, reaches it 
+ *           (clamping anti-windup), so it doesn't have to unwind after a long move
+ *           before the axis can stop. Since the integral is in 
+ *           output units, changing the integral gain doesn't make the output jump; 
+ *           @c set_gains() also moves the integral by however much the new gains 
+ *           change the other two terms, so a gain change is bumpless.
+ *
+ *           The derivative term damps the measured rate, so it has no kick when the
+ *           reference jumps, and the rate goes through a first order low pass filter
+ *           whose time constant is set for each controller.
+ */
+
+class pid
+{
+	protected:
+		int16_t  kp;                        ///< Proportional gain
+		int16_t  ki;                        ///< Integral gain
+		int16_t  kd;                        ///< Derivative gain
+		int32_t  p_input_max;               ///< Largest error whose P product fits
+		int32_t  i_input_max;               ///< Largest error sum whose I product fits
+		int32_t  d_input_max;               ///< Largest rate whose D product fits
+		uint16_t rate_hz;                   ///< Updates per second
+		int16_t  ki_dt;                     ///< Integral gain times the update period
+		int8_t   ki_dt_shift;               ///< Shift from a product with it to integral
+		int32_t  integral;                  ///< The integral term, 21 fraction bits
+		int32_t  integral_max;              ///< The integral is kept within +/- this
+		int32_t  error_old;                 ///< The error from the last update
+		int32_t  rate_old;                  ///< The filtered rate from the last update
+		int32_t  rate_scaled;               ///< The filtered rate times 2^d_shift
+		uint8_t  d_shift;                   ///< Base 2 log of the filter time constant
+		uint8_t  primed;                    ///< Nonzero once the filter has a rate
+		int16_t  output_max;                ///< The output is kept within +/- this
+
+		// This method works out the P and D terms for the last update's inputs
+		int32_t last_pd (void);
+
+	public:
+		// The constructor makes a controller with the given fixed point gains, which
+		// is run at the given rate
+		pid (int16_t a_kp, int16_t a_ki, int16_t a_kd, uint16_t a_rate_hz, 
+			 int16_t a_output_max = 0x7FFF, uint16_t a_d_filter_ms = 0);
+
+		// This method changes the gains, which are made with PID_GAIN(), bumplessly
+		void set_gains (int16_t a_kp, int16_t a_ki, int16_t a_kd);
+
+		// This method forgets the integral and the last inputs, as when the 
+		// controller is restarted
+		void reset (void);
+
+		// This method empties the integral, as when the output has no effect
+		void clear_integral (void) { integral = 0; }
+
+		// This method runs the controller once with a command fed forward and returns
+		// its output, which includes that command
+		int16_t update (int32_t error, int32_t rate, int16_t feed_forward = 0);
+};
+
+#ifdef PID_BENCH
+	// This function times the fixed point controller against the floating point code
+	// it replaced, and checks that they agree
+	void pid_bench_run (emstream* p_ser);
+#endif
+
+#endif // _PID_H_
@@ -50,48 +50,31 @@ extern TaskShare<int16_t>* p_share_1;
 // is the sink that utilizes the data item.
 extern TaskShare<int16_t>* p_share_2;
 
-// This shared data item is used to set the motor mode: power, brake, freewheel for motors
-// 1 and 2. Motor 1 uses integers 0 through 2 and motor 2 uses integers 3 through 5.
-extern TaskShare<uint8_t>* p_mode;
+// These shared data items are used to set the motor modes: power, brake, freewheel for
+// motors 1 and 2. Motor 1 uses integers 0 through 2 and motor 2 uses integers 3 through
+// 5, each in its own share so that both motors can be commanded at the same time.
+extern TaskShare<uint8_t>* p_mode_1;
+extern TaskShare<uint8_t>* p_mode_2;
+
+// This shared data item holds the time stamp, from encoder_time (), at which 
+// task_control read the encoders for the commands it last published
+extern TaskShare<uint16_t>* p_control_time;
+
+// These shared data items hold the latest and longest time in microseconds from the
+// encoders being read to task_motor applying the commands worked out from them
+extern TaskShare<uint16_t>* p_latency;
+extern TaskShare<uint16_t>* p_latency_max;
+
+// With -DCONTROL_TIMER, this shared data item holds the largest difference in 
+// microseconds between the time from one control update to the next and the period
+#ifdef CONTROL_TIMER
+	extern TaskShare<uint16_t>* p_jitter_max;
+#endif
 
 // This shared data item is used to read the state of the encoder tick used for comparison 
 // in the ISR.
 extern TaskShare<uint8_t>* p_state;
 
-// This shared data item is used to hold the state of the last encoder tick of encoder 1 used for 
-// comparison in the ISR.
-extern TaskShare<uint8_t>* p_state_old_1;
-
-// This shared data item is used to hold the state of the last encoder tick of encoder 2 used for 
-// comparison in the ISR.
-extern TaskShare<uint8_t>* p_state_old_2;
-
-// This shared data item is used to hold the count for current number of errors. This number 
-// is incremented in the ISR when applicable and read using error_count method.
-extern TaskShare<uint32_t>* p_error_cntr;
-
-// This shared data item is used to hold the count for current position of encoder 1. This number 
-// is incremented or decremented based on comparsion of current and old states in the ISR and 
-// read using view_count method.
-extern TaskShare<uint32_t>* p_encoder_cntr_1;
-
-// This shared data item is used to hold the count for current position of encoder 2. This number 
-// is incremented or decremented based on comparsion of current and old states in the ISR and 
-// read using view_count method.
-extern TaskShare<uint32_t>* p_encoder_cntr_2;
-
-// This shared data is used to hold the location of channel A external interrupt pin.
-extern TaskShare<uint8_t>* p_ext_pin_A;
-
-// This shared data is used to hold the location of channel B external interrupt pin.
-extern TaskShare<uint8_t>* p_ext_pin_B;
-
-// This shared data is used to hold the location of channel C external interrupt pin.
-extern TaskShare<uint8_t>* p_ext_pin_C;
-
-// This shared data is used to hold the location of channel D external interrupt pin.
-extern TaskShare<uint8_t>* p_ext_pin_D;
-
 // This shared data item is used to hold the position sent to the control loop for motor 1
 extern TaskShare<int16_t>* p_position_1;
 
@@ -101,16 +84,29 @@ extern TaskShare<int16_t>* p_position_2;
 // This shared data item is used to signal task_trigger to pull the gun's trigger
 extern TaskShare<bool>* fire_at_will;
 
-// These are shared data items to read the IR sensors
-extern TaskShare<uint16_t>* p_high_left;
-extern TaskShare<uint16_t>* p_high_right;
-extern TaskShare<uint16_t>* p_center;
-extern TaskShare<uint16_t>* p_low_left;
-extern TaskShare<uint16_t>* p_low_right;
+// This double buffer holds the newest frame of IR sensor readings, each sensor's 
+// reading above ambient light and signal to noise ratio from the same scan
+struct sensor_frame_t;
+template <class T> class double_buffer;
+extern double_buffer<sensor_frame_t>* p_sensor_frame;
 
 // These shared data items are position done flags for the control loop
 extern TaskShare<bool>* p_pos_done_1;
 extern TaskShare<bool>* p_pos_done_2;
+
+// These shared data items hold the time left until each axis's motion profile 
+// arrives at its reference position, in milliseconds
+extern TaskShare<uint16_t>* p_eta_1;
+extern TaskShare<uint16_t>* p_eta_2;
+
+// This is the A/D converter driver, shared by every task which reads the converter
+class adc;
+extern adc* p_adc;
+
+// These are the motor drivers; p_motor_1 drives the gun angle and p_motor_2 the base
+class Motor;
+extern Motor* p_motor_1;
+extern Motor* p_motor_2;
 		
 
 #endif // _SHARES_H_
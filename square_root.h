@@ -0,0 +1,64 @@
+//======================================================================================
+/** @file square_root.h
+ *    This file contains an integer square root, for code which needs one without
+ *    pulling in the floating point library.
+ *
+ *  Revisions:
+ *    @li 10-16-2026 Original file, moved out of adc.cpp
+ *
+ *  License:
+ *    This file is copyright 2026 by its authors and released under the Lesser GNU
+ *    Public License, version 2, as the rest of this project is. It is intended for
+ *    educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//======================================================================================
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _SQUARE_ROOT_H_
+#define _SQUARE_ROOT_H_
+
+#include <stdint.h>                         // Standard integer types
+
+
+//-------------------------------------------------------------------------------------
+/** This function finds the integer square root of a number, one bit at a time, with
+ *  only shifts, additions and subtractions.
+ *  @param   number The number whose square root is wanted
+ *  @return  The square root, rounded down
+ */
+
+inline uint16_t square_root (uint32_t number)
+{
+	uint32_t root = 0;
+	uint32_t bit = 1UL << 30;
+
+	while (bit > number)
+	{
+		bit >>= 2;
+	}
+	while (bit)
+	{
+		if (number >= root + bit)
+		{
+			number -= root + bit;
+			root = (root >> 1) + bit;
+		}
+		else
+		{
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+	return ((uint16_t)root);
+}
+
+#endif // _SQUARE_ROOT_H_
@@ -23,6 +23,9 @@
  *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 //**************************************************************************************
 
+#include <util/atomic.h>                    // Blocks of code with interrupts off
+
+#include "semphr.h"                         // Header for FreeRTOS semaphores
 #include "textqueue.h"                      // Header for text queue class
 #include "task_control.h"                	// Header for this task
 #include "shares.h"                         // Shared inter-task communications
@@ -35,10 +38,75 @@
 #define free_2  4							// way makes the code easier to read and 
 #define power_2 5							// understand.
 
+static_assert (PID_ERROR_BITS == ENCODER_FRACTION_BITS, 
+			   "The controllers' errors must have the encoders' fraction bits");
+
+static_assert (CONTROL_HZ >= 1 && CONTROL_HZ <= 0xFFFF, 
+			   "The controllers must be run from 1 to 65535 times a second");
+
+#ifdef CONTROL_TIMER
+
+static_assert (CONTROL_TIMER_TOP > 0 && CONTROL_TIMER_TOP <= 0xFF,
+			   "Timer 2 can't make interrupts at CONTROL_TIMER_HZ");
+
+/// The semaphore which the timer 2 interrupt gives to wake the control task
+static SemaphoreHandle_t control_tick;
+
+/// The time stamp, from encoder_time (), at which the timer 2 interrupt last ran
+static volatile uint16_t control_tick_time;
+
+
+//-------------------------------------------------------------------------------------
+/** This interrupt service routine runs at @c CONTROL_TIMER_HZ, on timer 2's compare
+ *  match. It notes the time and wakes the control task, switching to it straight away
+ *  if it outranks the task which was interrupted.
+ */
+
+ISR (TIMER2_COMPA_vect)
+{
+	BaseType_t woken = pdFALSE;
+
+	control_tick_time = encoder_time ();
+	xSemaphoreGiveFromISR (control_tick, &woken);
+	if (woken)
+	{
+		taskYIELD ();
+	}
+}
+
+#endif // CONTROL_TIMER
+
+
+//-------------------------------------------------------------------------------------
+/** This function works out the motor command which a profile's speed and acceleration
+ *  need, from @c CONTROL_KV and @c CONTROL_KA, kept within @c CONTROL_OUTPUT_MAX.
+ *  @param   a_profile The motion profile which an axis is following
+ *  @return  The command which the axis's controller feeds forward
+ */
+
+static int16_t feed_forward (trajectory& a_profile)
+{
+	int32_t command = ((int32_t)a_profile.speed () * CONTROL_KV 
+					   + a_profile.acceleration () * CONTROL_KA) >> PID_GAIN_BITS;
+
+	if (command > CONTROL_OUTPUT_MAX)
+	{
+		return (CONTROL_OUTPUT_MAX);
+	}
+	if (command < -CONTROL_OUTPUT_MAX)
+	{
+		return (-CONTROL_OUTPUT_MAX);
+	}
+	return (command);
+}
+
+
 //-------------------------------------------------------------------------------------
 /** This constructor creates a task which reads input from an encoder and controls the 
  *  encoder using input from @c task_user. The main job of this constructor is to call the
- *  constructor of parent class (\c frt_task ).
+ *  constructor of parent class (\c frt_task ). The two controllers, the gun's first and
+ *  then the base's, are set up here too; their integral gains are per second, so they 
+ *  don't depend on how often the loop runs. So are the axes' motion profiles.
  *  @param a_name A character string which will be the name of this task
  *  @param a_priority The priority at which this task will initially run (default: 0)
  *  @param a_stack_size The size of this task's stack in bytes 
@@ -49,7 +117,13 @@
 
 task_control::task_control (const char* a_name, unsigned portBASE_TYPE a_priority, 
 							size_t a_stack_size, emstream* p_ser_dev)
-							: TaskBase (a_name, a_priority, a_stack_size, p_ser_dev)
+							: TaskBase (a_name, a_priority, a_stack_size, p_ser_dev),
+							pid_1 (PID_GAIN (0.6), PID_GAIN (1.0), PID_GAIN (0.01), CONTROL_HZ,
+								   CONTROL_OUTPUT_MAX, CONTROL_D_FILTER_MS),
+							pid_2 (PID_GAIN (1.0), PID_GAIN (1.0), PID_GAIN (0.01), CONTROL_HZ,
+								   CONTROL_OUTPUT_MAX, CONTROL_D_FILTER_MS),
+							profile_1 (CONTROL_SPEED_1, CONTROL_ACCEL_1, CONTROL_HZ),
+							profile_2 (CONTROL_SPEED_2, CONTROL_ACCEL_2, CONTROL_HZ)
 {
 	
 	// Nothing is done in the body of this constructor. All the work is done in the
@@ -60,63 +134,139 @@ task_control::task_control (const char* a_name, unsigned portBASE_TYPE a_priorit
 //-------------------------------------------------------------------------------------
 /** This method is called once by the RTOS scheduler. It constructs the encoder 
  *  to run using external interrupts. Each time around the for (;;) loop, the encoder 
- *  is updated with the latest shared variables from the motor and/or task_user.
+ *  is updated with the latest shared variables from the motor and/or task_user. With
+ *  @c -DCONTROL_TIMER, it first sets timer 2 to interrupt at @c CONTROL_TIMER_HZ, and
+ *  each time around the loop waits for that interrupt rather than for a delay.
  */
 
 void task_control::run (void)
 {
-	// Make a variable which will hold times to use for precise task scheduling
-	TickType_t previousTicks = xTaskGetTickCount ();
+	#ifndef CONTROL_TIMER
+		// Make a variable which will hold times to use for precise task scheduling
+		TickType_t previousTicks = xTaskGetTickCount ();
+	#endif
 
 	dead_zone = 20;
 	hinge_limit = 1100;
+	count = 0;
+	
+	// The profiles start wherever the motors are, so they don't move at start-up
+	profile_1.start (GunEncoder::view_position () / ENCODER_ONE);
+	profile_2.start (BaseEncoder::view_position () / ENCODER_ONE);
+	
+	#ifdef CONTROL_TIMER
+		latency_max = 0;
+		jitter_max = 0;
+		
+		// Timer 2 runs in CTC mode at F_CPU / 128, interrupting each time it reaches
+		// the top; the semaphore must be made before its interrupt can run
+		control_tick = xSemaphoreCreateBinary ();
+		TCCR2A = (1 << WGM21);
+		TCCR2B = (1 << CS22) | (1 << CS20);
+		OCR2A = CONTROL_TIMER_TOP;
+		TIMSK2 |= (1 << OCIE2A);
+		
+		// The first wake-up has no period before it to measure
+		xSemaphoreTake (control_tick, portMAX_DELAY);
+		ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+		{
+			wake_time_old = encoder_time ();
+		}
+	#endif
 	
 	// This is the task loop for the control task. This loop runs until the
 	// power is turned off or something equally dramatic occurs
 	for (;;)
 	{
+		#ifdef CONTROL_TIMER
+			uint16_t wake_time;
+			xSemaphoreTake (control_tick, portMAX_DELAY);
+			ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+			{
+				tick_time = control_tick_time;
+				wake_time = encoder_time ();
+			}
+			
+			// The jitter is how far the time since the last wake-up is from one 
+			// period; a missed interrupt shows up as a whole period of it
+			uint16_t jitter = abs ((int16_t)(uint16_t)(wake_time - wake_time_old) 
+								   - (int16_t)CONTROL_TIMER_TICKS) 
+							  * (1000000UL / ENCODER_TIMER_HZ);
+			wake_time_old = wake_time;
+			if (jitter > jitter_max)
+			{
+				jitter_max = jitter;
+				p_jitter_max -> put(jitter_max);
+			}
+		#endif
+		
+		// Both axes are sampled, worked out and published in the same run through
+		// the loop, so neither is steered by an error from a period ago
 		ref_pos_1 = p_position_1->get();
 		ref_pos_2 = p_position_2->get();
 						
-		current_pos_1 = p_encoder_cntr_1->get();
-		current_pos_2 = p_encoder_cntr_2->get();
+		// Positions and errors are interpolated between encoder edges, so they're in
+		// fractions of a count; ENCODER_ONE is one count. The time they were read is
+		// sent along with the commands, so task_motor can measure the latency
+		ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+		{
+			sample_time = encoder_time ();
+		}
+		current_pos_1 = GunEncoder::view_position ();
+		current_pos_2 = BaseEncoder::view_position ();
 		
-		error_1 = ref_pos_1 - current_pos_1;
-		error_2 = ref_pos_2 - current_pos_2;
+		// Each profile takes a step toward its reference position, and the error is
+		// from the profile's setpoint rather than from the reference, so a jump in
+		// the reference doesn't become a jump in the error
+		error_1 = (profile_1.update (ref_pos_1) 
+				   >> (TRAJECTORY_BITS - ENCODER_FRACTION_BITS)) - current_pos_1;
+		error_2 = (profile_2.update (ref_pos_2) 
+				   >> (TRAJECTORY_BITS - ENCODER_FRACTION_BITS)) - current_pos_2;
 
-		KP_out_1 = error_1*KP_1;
-		KP_out_2 = error_2*KP_2;
-		
-		KI_out_1 = ((error_old_1 + error_1) * KI_1);
-		KI_out_2 = ((error_old_2 + error_2) * KI_2);
-			
-		speed_out_1 = (KP_out_1 + KI_out_1 + KD_out_1);
-		speed_out_2 = (KP_out_2 + KI_out_2 + KD_out_2);
+		// The derivative term damps the filtered measured velocity, rather than 
+		// differencing the position error, so it has no kick when the reference 
+		// position jumps. Whenever an axis is braked its controller's output has no 
+		// effect, so its integral is emptied rather than left to wind up. The command
+		// which the profile's speed and acceleration need is fed through the 
+		// controller, so it only has to correct what that gets wrong and its 
+		// integral doesn't wind up while the two together are at full command
+		speed_out_1 = pid_1.update (error_1, GunEncoder::velocity (), 
+									feed_forward (profile_1));
+		speed_out_2 = pid_2.update (error_2, BaseEncoder::velocity (), 
+									feed_forward (profile_2));
 			
+		// Whether each axis has arrived at the reference read above
+		bool done_1 = false;
+		bool done_2 = false;
+		
 // 		MOTOR 1:	
-		// Brakes the motor if close to final position
-		if ((error_1<=10 && error_1>=-10) || (speed_out_1==0))
+		// Brakes the motor if the profile has arrived and it's close to final position
+		if ((profile_1.arrived () && error_1<=10*ENCODER_ONE && error_1>=-10*ENCODER_ONE)
+			|| (speed_out_1==0))
 		{
-			p_mode -> put(brake_1);
-			p_pos_done_1 -> put(true);
+			mode_1 = brake_1;
+			pid_1.clear_integral ();
+			done_1 = true;
 		}
 			
  		// Brakes the motor if close to hinge limit
-		else if ((speed_out_1 > 1) && (current_pos_1 >= hinge_limit))
+		else if ((speed_out_1 > 1) && (current_pos_1 >= hinge_limit*ENCODER_ONE))
 		{				
-			p_mode -> put(brake_1);
+			mode_1 = brake_1;
+			pid_1.clear_integral ();
 		}
 		// Brakes the motor if going past zero
 		else if ((speed_out_1 < -1) && (current_pos_1 <= 0))
 		{
-			p_mode -> put(brake_1);
+			mode_1 = brake_1;
+			pid_1.clear_integral ();
 		}
 		
 		// Positive speed cap
 		else if (speed_out_1 > 300)
 		{
 			speed_out_1 =300;
-			p_mode -> put(power_1);
+			mode_1 = power_1;
 		}
 		
 		// Motor will not spin unless power is greater than that defined by
@@ -124,47 +274,42 @@ void task_control::run (void)
 		else if (speed_out_1 < dead_zone && speed_out_1>0)
 		{
 			speed_out_1=dead_zone;
-			p_mode -> put(power_1);
+			mode_1 = power_1;
 		}
 		
 		else if (speed_out_1 > -dead_zone && speed_out_1<0)
 		{
 			speed_out_1=-dead_zone;
-			p_mode -> put(power_1); 
+			mode_1 = power_1; 
 		}
 		
 		// Negative speed cap
 		else if(speed_out_1 < -300)
 		{
 			speed_out_1 = -300;
-			p_mode -> put(power_1);
+			mode_1 = power_1;
 		}
 				
 		else
 		{
-			p_mode -> put(power_1);
+			mode_1 = power_1;
 		}
 		
-		error_old_1 = error_1;
-		p_share_1 -> put(speed_out_1);
-		p_position_1 -> put(ref_pos_1);
-		
-		//Delay control loop between motor 1 and motor 2
-		delay_from_for_ms (previousTicks, 30);	
-		
 // 		MOTOR 2:
-		// Brakes the motor if close to final position
-		if((error_2<=30 && error_2>=-30) /*|| (speed_out_2==0)*/)
+		// Brakes the motor if the profile has arrived and it's close to final position
+		if(profile_2.arrived () && (error_2<=30*ENCODER_ONE && error_2>=-30*ENCODER_ONE)
+		   /*|| (speed_out_2==0)*/)
 		{
-			p_mode -> put(brake_2);
-			p_pos_done_2 -> put(true);
+			mode_2 = brake_2;
+			pid_2.clear_integral ();
+			done_2 = true;
 		}
 		
 		// Positive speed cap
 		else if(speed_out_2 > 300)
 		{
 			speed_out_2 =300;
-			p_mode -> put(power_2);
+			mode_2 = power_2;
 		}
 		
 		// Motor will not spin unless power is greater than that defined by
@@ -172,39 +317,105 @@ void task_control::run (void)
 		else if ((speed_out_2 < dead_zone) && (speed_out_2>0))
 		{
 			speed_out_2=dead_zone;
-			p_mode -> put(power_2);
+			mode_2 = power_2;
 		}
 		
 		else if ((speed_out_2 > -dead_zone) && (speed_out_2<0))
 		{
 			speed_out_2=-dead_zone;
-			p_mode -> put(power_2);
+			mode_2 = power_2;
 		}
 		
 		// Negative speed cap
 		else if(speed_out_2 < -300)
 		{
 			speed_out_2 = -300;
-			p_mode -> put(power_2);
+			mode_2 = power_2;
 		}
 				
 		else
 		{
-			p_mode -> put(power_2);
+			mode_2 = power_2;
 		}
-			
-		error_old_2 = error_2;
-		p_share_2 -> put(speed_out_2);
-		p_position_2 -> put(ref_pos_2);
 		
-		// Outputs position to serial port for debugging.
-		// Note: motors will not run without ARS being printed to the serial port for some reason
-		*p_print_ser_queue  << "A: "<< current_pos_2 << endl;
-		*p_print_ser_queue  << "R: "<< ref_pos_2 << endl;
-		*p_print_ser_queue  << "S: "<< speed_out_2 << endl;
-		
-		// This is a method we use to cause a task to make one run through its task
-		// loop every N milliseconds and let other tasks run at other times
-		delay_from_for_ms (previousTicks, 30);		
+		// A done flag only means something for the reference it was worked out for.
+		// If task_position has moved a reference since it was read, that axis isn't
+		// flagged until a later run; the check and the flag are made with the 
+		// scheduler stopped, so the reference can't move in between
+		vTaskSuspendAll ();
+		if (done_1 && p_position_1->get() == ref_pos_1)
+		{
+			p_pos_done_1 -> put(true);
+		}
+		if (done_2 && p_position_2->get() == ref_pos_2)
+		{
+			p_pos_done_2 -> put(true);
+		}
+		xTaskResumeAll ();
+			
+		#ifdef CONTROL_TIMER
+			// The motors are set straight away rather than by task_motor, and the
+			// latency is the time since the interrupt which started this update
+			if (mode_1 == brake_1)
+			{
+				p_motor_1->brake ();
+			}
+			else
+			{
+				p_motor_1->set_power (speed_out_1);
+			}
+			if (mode_2 == brake_2)
+			{
+				p_motor_2->brake ();
+			}
+			else
+			{
+				p_motor_2->set_power (speed_out_2);
+			}
+			
+			uint16_t set_time;
+			ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+			{
+				set_time = encoder_time ();
+			}
+			uint16_t latency = (uint16_t)(set_time - tick_time) 
+							   * (1000000UL / ENCODER_TIMER_HZ);
+			if (latency > latency_max)
+			{
+				latency_max = latency;
+				p_latency_max -> put(latency_max);
+			}
+			p_latency -> put(latency);
+			p_eta_1 -> put(profile_1.eta_ms ());
+			p_eta_2 -> put(profile_2.eta_ms ());
+		#else
+			// Both motors' commands are published with the scheduler stopped, so 
+			// task_motor never gets one motor's new command and the other's old one
+			vTaskSuspendAll ();
+			p_share_1 -> put(speed_out_1);
+			p_mode_1 -> put(mode_1);
+			p_share_2 -> put(speed_out_2);
+			p_mode_2 -> put(mode_2);
+			p_control_time -> put(sample_time);
+			p_eta_1 -> put(profile_1.eta_ms ());
+			p_eta_2 -> put(profile_2.eta_ms ());
+			xTaskResumeAll ();
+			
+			// Outputs position to serial port for debugging, but not every time 
+			// through the loop, which would be more than the serial port can send.
+			// The timer driven loop doesn't print, as it mustn't wait for room in 
+			// the print queue
+			if (++count >= CONTROL_PRINT_PERIODS)
+			{
+				count = 0;
+				*p_print_ser_queue  << "A: "<< current_pos_2 / ENCODER_ONE << endl;
+				*p_print_ser_queue  << "R: "<< ref_pos_2 << endl;
+				*p_print_ser_queue  << "S: "<< speed_out_2 << endl;
+			}
+			
+			// This is a method we use to cause a task to make one run through its 
+			// task loop every N milliseconds and let other tasks run at other times
+			delay_from_for_ms (previousTicks, CONTROL_PERIOD_MS);
+		#endif
 	}
 }
\ No newline at end of file
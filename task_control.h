@@ -44,13 +44,96 @@
 #include "rs232int.h"                       // ME405/507 library for serial comm.
 #include "motor_driver.h"					// Header for Motor driver class
 #include "encoder_driver.h"                 // Header for Encoder driver class
+#include "pid.h"                            // Header for the fixed point PID class
+#include "trajectory.h"                     // Header for the motion profile class
 
 #include "emstream.h"                       // Header for serial ports and devices
 
+/** The period of the control loop in milliseconds. Both motors are updated each time,
+ *  and @c task_motor runs at the same rate. */
+#ifndef CONTROL_PERIOD_MS
+	#define CONTROL_PERIOD_MS  10
+#endif
+
+#ifdef CONTROL_TIMER
+	/** The rate in Hz at which timer 2 wakes the control task when it's built with 
+	 *  @c -DCONTROL_TIMER. Timer 2 counts at F_CPU / 128, so the rate can't be below 
+	 *  489 Hz, and it's exact when it divides 125000. */
+	#ifndef CONTROL_TIMER_HZ
+		#define CONTROL_TIMER_HZ  1000
+	#endif
+
+	/// The timer 2 compare value which gives interrupts at @c CONTROL_TIMER_HZ
+	#define CONTROL_TIMER_TOP  (F_CPU / 128 / CONTROL_TIMER_HZ - 1)
+
+	/// The control period in time stamp ticks, against which the jitter is measured
+	#define CONTROL_TIMER_TICKS  (ENCODER_TIMER_HZ / CONTROL_TIMER_HZ)
+#endif
+
+/// The number of control periods between debugging printouts, about a tenth of a second
+#define CONTROL_PRINT_PERIODS  (100 / CONTROL_PERIOD_MS)
+
+/// The number of times a second the controllers are run, which sets their time base
+#ifdef CONTROL_TIMER
+	#define CONTROL_HZ  CONTROL_TIMER_HZ
+#else
+	#define CONTROL_HZ  (1000 / CONTROL_PERIOD_MS)
+#endif
+
+/// The largest command the controllers give, past full PWM
+#define CONTROL_OUTPUT_MAX  300
+
+/// The time constant of the low pass filter on each axis's rate, in milliseconds
+#define CONTROL_D_FILTER_MS  40
+
+/// The speed limits of the gun's and the base's motion profiles, in counts per second
+#ifndef CONTROL_SPEED_1
+	#define CONTROL_SPEED_1  1500
+#endif
+#ifndef CONTROL_SPEED_2
+	#define CONTROL_SPEED_2  1500
+#endif
+
+/// The accelerations of the gun's and the base's motion profiles, in counts/s^2
+#ifndef CONTROL_ACCEL_1
+	#define CONTROL_ACCEL_1  16000
+#endif
+#ifndef CONTROL_ACCEL_2
+	#define CONTROL_ACCEL_2  16000
+#endif
+
+/** The motor command fed forward per count per second of the profile's speed, made 
+ *  with @c PID_GAIN(); it's the inverse of the motor's speed per unit of command. */
+#ifndef CONTROL_KV
+	#define CONTROL_KV  PID_GAIN (0.083)
+#endif
+
+/** The motor command fed forward per count per second squared of the profile's 
+ *  acceleration, made with @c PID_GAIN(); it's @c CONTROL_KV times the motor's time
+ *  constant in seconds. */
+#ifndef CONTROL_KA
+	#define CONTROL_KA  PID_GAIN (0.0167)
+#endif
+
 //-------------------------------------------------------------------------------------
 /** @brief   This task controls and reads a motor with an encoder
  *  @details The encoder is read and controller is run using a driver in files @c encoder_driver.h and 
  *           @c encoder_driver.cpp.
+ *
+ *           Normally the task runs every @c CONTROL_PERIOD_MS and hands its commands
+ *           to @c task_motor through shared variables. When it's built with 
+ *           @c -DCONTROL_TIMER, a timer 2 compare interrupt wakes it at 
+ *           @c CONTROL_TIMER_HZ instead, and it drives the motors itself as soon as it 
+ *           has worked out their commands, so neither the RTOS tick nor the motor 
+ *           task's period adds to the delay. It then measures how late each wake-up 
+ *           is, as jitter, and how long after each interrupt the motors were set.
+ *
+ *           The positions from the setpoint shares aren't given to the controllers
+ *           straight away; each axis has a motion profile which moves toward them 
+ *           with limited speed and acceleration, and its controller follows that, 
+ *           with the profile's speed and acceleration fed forward so the error stays
+ *           small. An axis is only braked as done once its profile has arrived, and 
+ *           the time left until then is published for each axis.
  */
 
 class task_control : public TaskBase
@@ -59,30 +142,41 @@ class task_control : public TaskBase
 		// No private variables or methods for this class
 
 	protected:
+		// Positions and errors are interpolated, in counts times ENCODER_ONE
 		int32_t current_pos_1;
 		int32_t current_pos_2;
 		int32_t ref_pos_1;
 		int32_t ref_pos_2;
-		const double KP_1 = .5;
-		const double KI_1 = .05;
-		const double KP_2 = 1;
-		const double KI_2 = .01;
-		int8_t KD;
-		int32_t error_old_1;
-		int32_t error_old_2;
 		int32_t error_1;
 		int32_t error_2;
-		double KP_out_1;
-		double KP_out_2;
-		double KI_out_1;
-		double KI_out_2;
-		double KD_out_1;
-		double KD_out_2;
-		double speed_out_1;
-		double speed_out_2;
+		
+		// The controllers work in fixed point, since the AVR has no floating point
+		// hardware; their gains, limits and filters are set in the constructor
+		pid pid_1;
+		pid pid_2;
+		
+		// The motion profiles which the controllers follow
+		trajectory profile_1;
+		trajectory profile_2;
+		int16_t speed_out_1;
+		int16_t speed_out_2;
+		uint8_t mode_1;
+		uint8_t mode_2;
+		
+		// Time stamp at which the encoders were read, from encoder_time ()
+		uint16_t sample_time;
 		int8_t dead_zone;
 		uint16_t hinge_limit;
 		uint8_t count;
+		
+		#ifdef CONTROL_TIMER
+			// Time stamps of the last interrupt and of the last wake-up, and the
+			// worst latency and jitter yet, in microseconds
+			uint16_t tick_time;
+			uint16_t wake_time_old;
+			uint16_t latency_max;
+			uint16_t jitter_max;
+		#endif
 
 	public:
 		// This constructor creates a generic task of which many copies can be made
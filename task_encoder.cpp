@@ -50,8 +50,11 @@ task_encoder::task_encoder (const char* a_name, unsigned portBASE_TYPE a_priorit
 
 //-------------------------------------------------------------------------------------
 /** This method is called once by the RTOS scheduler. It constructs the encoder 
- *  to run using external interrupts. Each time around the for (;;) loop, the encoder 
- *  is updated with the latest shared variables from the motor, control loop, and/or task_user.
+ *  to run using external interrupts. Each time around the for (;;) loop, the velocity
+ *  estimate of each encoder is updated; the loop period is the velocity counting window.
+ *  When the encoder driver is compiled with @c -DENCODER_BATCHED, the loop runs every
+ *  millisecond instead and decodes the edges queued by the ISRs on each pass, updating
+ *  the velocities on every tenth pass.
  */
 
 void task_encoder::run (void)
@@ -60,19 +63,38 @@ void task_encoder::run (void)
 	TickType_t previousTicks = xTaskGetTickCount ();
 	
 	// Constructer call for the encoder driver, p_encoder_1 measures the gun angle
-	Encoder* p_encoder_1 = new Encoder (p_serial, &PORTE, &DDRE, &PINE, ISC40, ISC41, 4, ISC50, 
-									  ISC51, 5);
+	GunEncoder* p_encoder_1 = new GunEncoder (p_serial);
 	
 	// p_encoder_2 measures the base rotation
-	Encoder* p_encoder_2 = new Encoder (p_serial, &PORTE, &DDRE, &PINE, ISC60, ISC61, 6, ISC70, 
-									  ISC71, 7);
+	BaseEncoder* p_encoder_2 = new BaseEncoder (p_serial);
+	
+	#ifdef ENCODER_BATCHED
+		// Count of passes through the loop, used to space out velocity updates
+		uint8_t passes = 0;
+	#endif
 	
 	// This is the task loop for the encoder task. This loop runs until the
 	// power is turned off or something equally dramatic occurs
 	for (;;)
-	{		
-		// This is a method we use to cause a task to make one run through its task
-		// loop every N milliseconds and let other tasks run at other times
-		delay (100);		
+	{
+		#ifdef ENCODER_BATCHED
+			GunEncoder::drain ();
+			BaseEncoder::drain ();
+			
+			if (++passes >= 10)
+			{
+				passes = 0;
+				GunEncoder::update_velocity ();
+				BaseEncoder::update_velocity ();
+			}
+			delay_from_for_ms (previousTicks, 1);
+		#else
+			GunEncoder::update_velocity ();
+			BaseEncoder::update_velocity ();
+			
+			// This is a method we use to cause a task to make one run through its task
+			// loop every N milliseconds and let other tasks run at other times
+			delay_from_for_ms (previousTicks, 10);
+		#endif
 	}
 }
\ No newline at end of file
@@ -73,9 +73,6 @@ class task_encoder : public TaskBase
 		void run (void);
 };
 
-// This operator prints the A/D converter (see file adc.cpp for details). It's not 
-// a part of class adc, but it operates on objects of class adc
-// emstream& operator << (emstream&, adc&);
-emstream& operator << (emstream&, Encoder&);
+// The operator which prints an Encoder is a template in encoder_driver.h
 
 #endif // _TASK_ENCODER_H_
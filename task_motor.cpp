@@ -30,9 +30,12 @@
  *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 //**************************************************************************************
 
+#include <util/atomic.h>                    // Blocks of code with interrupts off
+
 #include "textqueue.h"                      // Header for text queue class
 #include "task_motor.h"                		// Header for this task
 #include "shares.h"                         // Shared inter-task communications
+#include "task_control.h"                   // Header for the control loop's period
 
 #define brake_1 0                           // These defines help make the code more
 #define free_1  1							// readable. Enumeration data types were 
@@ -63,9 +66,9 @@ task_motor::task_motor (const char* a_name, unsigned portBASE_TYPE a_priority,
 
 
 //-------------------------------------------------------------------------------------
-/** This method is called once by the RTOS scheduler. It constructs the motor driver
- *  to run using fast PWM for two separate instances. Each time around the for (;;)
- *  loop, the motor driver is updated with the latest shared variables from task_user.
+/** This method is called once by the RTOS scheduler. It runs the two motor drivers,
+ *  which @c main() has set up to use fast PWM. Each time around the for (;;) loop, 
+ *  the motor drivers are updated with the latest shared variables from task_control.
  */
 
 void task_motor::run (void)
@@ -73,103 +76,97 @@ void task_motor::run (void)
 	// Make a variable which will hold times to use for precise task scheduling
 	TickType_t previousTicks = xTaskGetTickCount ();
 	
-	// The following lines of code construct the motor driver for two separate instances
-	// of the motor_driver. Each instance controls a different motor. p_motor_1 controls
-	// the gun angle
-	Motor* p_motor_1 = new Motor (p_serial, &PORTC, &DDRC, 0, &PORTC, &DDRC, 1, &PORTC,
-								  &DDRC, 2, &PORTB, &DDRB, 6, &OCR1B);
-	
-	// p_motor_2 drives the base rotations
-	Motor* p_motor_2 = new Motor (p_serial, &PORTD, &DDRD, 5, &PORTD, &DDRD, 6, &PORTD,
-								  &DDRD, 7, &PORTB, &DDRB, 5, &OCR1A);
-	
-	
-	// These lines configure fast 8-bit fast PWM for motor 2
-	TCCR1A |= (1 << WGM10)
-			 | (1 << COM1A1) | (1 << COM1B1);
-	TCCR1A &= ~(1 << COM1A0) & ~(1 << COM1B0);
-
-	// The CS11 and CS10 bits set the prescaler for this timer/counter to run the
-	// timer at F_CPU / 64
-	TCCR1B |= (1 << WGM12)
-			 | (1 << CS11)  | (1 << CS10);
-
-	// To set 8-bit fast PWM mode we must set bits WGM30 and WGM32, which are in two
-	// different registers (ugh). We use COM3B1 and Com3B0 to set up the PWM so that
-	// the pin output will have inverted sense, that is, a 0 is on and a 1 is off; 
-	// this is needed because the LED connects from Vcc to the pin. 
-	TCCR3A |= (1 << WGM30)
-			 | (1 << COM3B1) | (1 << COM3B0);
-
-	// The CS31 and CS30 bits set the prescaler for this timer/counter to run the
-	// timer at F_CPU / 64
-	TCCR3B |= (1 << WGM32)
-			 | (1 << CS31)  | (1 << CS30);
+	// The motor drivers p_motor_1, for the gun angle, and p_motor_2, for the base
+	// rotation, and the PWM timer which they share are set up in main()
 
 	// This is the task loop for the motor control task. This loop runs until the
 	// power is turned off or something equally dramatic occurs
+	control_time = 0;
+	latency_max = 0;
 	for (;;)
 	{
 		// The shared variables are stored locally for use as inputs to the motor driver
-		mode = p_mode->get();
+		mode_1 = p_mode_1->get();
+		mode_2 = p_mode_2->get();
 		speed_1 = p_share_1->get();
 		speed_2 = p_share_2->get();
 		
 		// Motor 1 is controlled using modes 0 through 2, which correspond to brake_1,
 		// free_1, and power_1 respectively. Speed is only used as an input to the method
 		// set_power.
-		if(mode < 3)
+		switch(mode_1)
 		{
-			switch(mode)
-			{
-				case(brake_1):
-					p_motor_1->brake();
-					break;
-				
-				case(free_1):
-					p_motor_1->freewheel();
-					break;
-				
-				case(power_1):
-					p_motor_1->set_power(speed_1);
-					break;
-				
-				default:
-					DBG (p_serial, "ERROR...ERROR... Abandon hope" << endl);
-					break;
-			}
+			case(brake_1):
+				p_motor_1->brake();
+				break;
+			
+			case(free_1):
+				p_motor_1->freewheel();
+				break;
+			
+			case(power_1):
+				p_motor_1->set_power(speed_1);
+				break;
+			
+			default:
+				DBG (p_serial, "ERROR...ERROR... Abandon hope" << endl);
+				break;
 		}
+		
 		// Motor 2 is controlled using modes 3 through 5, which correspond to brake_2,
 		// free_2, and power_2 respectively. Speed is only used as an input to the method
 		// set_power.
-		else
+		switch(mode_2)
+		{
+			case(brake_2):
+				p_motor_2->brake();
+				break;
+			
+			case(free_2):
+				p_motor_2->freewheel();
+				break;
+			
+			case(power_2):
+				p_motor_2->set_power(speed_2);
+				break;
+			
+			default:
+				DBG (p_serial, "ERROR...ERROR... Abandon hope" << endl);
+				break;
+		}
+		
+		// When the commands are new, the time since task_control read the encoders
+		// to work them out is the whole latency from measurement to motor. The clock
+		// is read with interrupts off, as the RTOS tick mustn't come in the middle
+		uint16_t sample_time = p_control_time->get();
+		if (sample_time != control_time)
 		{
-			switch(mode)
+			uint16_t now;
+			ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
 			{
-				case(brake_2):
-					p_motor_2->brake();
-					break;
-				
-				case(free_2):
-					p_motor_2->freewheel();
-					break;
-				
-				case(power_2):
-					p_motor_2->set_power(speed_2);
-					break;
-				
-				default:
-					DBG (p_serial, "ERROR...ERROR... Abandon hope" << endl);
-					break;
+				now = encoder_time ();
+			}
+			control_time = sample_time;
+			uint32_t latency = (uint32_t)(uint16_t)(now - sample_time) 
+							   * (1000000UL / ENCODER_TIMER_HZ);
+			if (latency > 0xFFFF)
+			{
+				latency = 0xFFFF;
+			}
+			if (latency > latency_max)
+			{
+				latency_max = latency;
+				p_latency_max->put(latency_max);
 			}
+			p_latency->put(latency);
 		}
 				
 		// This enables motor driver to print debug messages
 		*p_serial << (*p_serial, *p_motor_1);
 		*p_serial << (*p_serial, *p_motor_2);
 		
-		// This is a method we use to cause a task to make one run through its task
-		// loop every N milliseconds and let other tasks run at other times
-		delay_from_for_ms (previousTicks, 100);		
+		// This runs at the control loop's rate, so new commands are applied within
+		// one period of being worked out
+		delay_from_for_ms (previousTicks, CONTROL_PERIOD_MS);		
 	}
 }
\ No newline at end of file
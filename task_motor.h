@@ -65,9 +65,15 @@ class task_motor : public TaskBase
 		// No private variables or methods for this class
 
 	protected:
-		uint8_t mode;
+		uint8_t mode_1;
+		uint8_t mode_2;
 		int16_t speed_1;
 		int16_t speed_2;
+		
+		// The time task_control read the encoders for the last commands applied, and
+		// the longest latency yet, in microseconds
+		uint16_t control_time;
+		uint16_t latency_max;
 
 	public:
 		// This constructor creates a generic task of which many copies can be made
@@ -53,6 +53,24 @@ task_position::task_position (const char* a_name, unsigned portBASE_TYPE a_prior
 	state = 0;
 }
 
+//-------------------------------------------------------------------------------------
+/** This method sends @c pos_1 and @c pos_2 to @c task_control as its reference 
+ *  positions and clears both done flags, with the scheduler stopped. If 
+ *  @c task_control could run between clearing a flag and sending its position, it 
+ *  could see the old position still reached and set the flag again, and the new 
+ *  position would look reached before the motors had moved.
+ */
+
+void task_position::set_targets (void)
+{
+	vTaskSuspendAll ();
+	p_pos_done_1 -> put(false);
+	p_pos_done_2 -> put(false);
+	p_position_1 -> put(pos_1);
+	p_position_2 -> put(pos_2);
+	xTaskResumeAll ();
+}
+
 //-------------------------------------------------------------------------------------
 /** This method is called once by the RTOS scheduler. It constructs the encoder 
  *  to run using external interrupts. Each time around the for (;;) loop, the encoder 
@@ -66,11 +84,12 @@ void task_position::run (void)
 	
 	state = 0;
 	hinge_limit = 500;
-	threshold = 10;
+	threshold = SENSOR_DETECT_SNR;
 	base_r_limit = 600;
 	base_l_limit = 1000;
 	runs = 0;
 	tol = 50;
+	last_sequence = 0;
 	p_pos_done_1 -> put(false);
 	p_pos_done_2 -> put(false);
 	
@@ -78,6 +97,22 @@ void task_position::run (void)
 	// power is turned off or something equally dramatic occurs
 	for (;;)
 	{		
+		// Each scan of the sensors is used once, all of its readings together, and
+		// only while it's fresh; a frame left over from before the sensor task 
+		// stalled mustn't steer the gun
+		p_sensor_frame -> get (frame);
+		fresh = (frame.sequence != last_sequence) && ((TickType_t)(xTaskGetTickCount () 
+				 - frame.time) <= SENSOR_STALE_MS / portTICK_PERIOD_MS);
+		if (fresh)
+		{
+			last_sequence = frame.sequence;
+			high_left = frame.signal[SENSOR_HIGH_LEFT];
+			high_right = frame.signal[SENSOR_HIGH_RIGHT];
+			center = frame.signal[SENSOR_CENTER];
+			low_left = frame.signal[SENSOR_LOW_LEFT];
+			low_right = frame.signal[SENSOR_LOW_RIGHT];
+		}
+		
 		switch (state)
 		{
 			// Spin 160 degrees from start position to face the target area
@@ -95,36 +130,30 @@ void task_position::run (void)
 			// Search for light source in target area
 			case (1):
 				// Gather shared variables into local variables
-				high_left = p_high_left -> get();
-				high_right = p_high_right-> get();
-				center = p_center-> get();
-				low_left = p_low_left-> get();
-				low_right = p_low_right-> get();
-				
 				pos_1 = p_position_1 -> get();
 				pos_2 = p_position_2 -> get();
  				
 				done_1 = p_pos_done_1 -> get();
 				done_2 = p_pos_done_2 -> get();
 				
-				// If any sensor reads above the threshold transition to state 2
-				if ((high_left >= threshold) || (high_right >= threshold) || 
-					(center >= threshold) || (low_left >= threshold) ||
-					(low_right >= threshold))
+				// If any sensor's signal stands out from its noise, transition to state 2
+				if (fresh)
 				{
-					transition_to (2);
+					for (uint8_t sensor = 0; sensor < SENSOR_COUNT; sensor++)
+					{
+						if (frame.snr[sensor] >= threshold)
+						{
+							transition_to (2);
+						}
+					}
 				}
 				
 				if (done_1==true && done_2==true)
 				{
-					p_pos_done_1-> put(false);
-					p_pos_done_2-> put(false);
-					
 					// If above hinge limit, go down
 					if (pos_1 >= hinge_limit)
 					{
 						pos_1 -= 10;
-						p_position_1 -> put(pos_1);
 					}
 					
 					// search pattern
@@ -148,9 +177,8 @@ void task_position::run (void)
 							}
 						}
 					}
-										
-					p_position_1 -> put(pos_1);
-					p_position_2 -> put(pos_2);
+					
+					set_targets ();
 				}
 
 				break;
@@ -158,12 +186,6 @@ void task_position::run (void)
 			// Lock on to target once the light source is found
 			case (2):
 				// Gather shared variables into local variables
-				high_left = p_high_left -> get();
-				high_right = p_high_right-> get();
-				center = p_center-> get();
-				low_left = p_low_left-> get();
-				low_right = p_low_right-> get();
-				
 				pos_1 = p_position_1 -> get();
 				pos_2 = p_position_2 -> get();
 				
@@ -171,12 +193,9 @@ void task_position::run (void)
 				done_2 = p_pos_done_2 -> get();
 				
 				// Wait until task_control sets done flags, indicating the reference
-				// position has been reached
-				if (done_1==true && done_2==true)
+				// position has been reached, and for a new scan taken there
+				if (fresh && done_1==true && done_2==true)
 				{
-					p_pos_done_1-> put(false);
-					p_pos_done_2-> put(false);
-					
 					// Pull trigger if in final position
 					if ((center > (low_right - tol)) && (center > (high_right - tol)) 
 						&& (center > (low_left - tol)) && (center > (low_right - tol))
@@ -209,8 +228,7 @@ void task_position::run (void)
 					{
 						*p_print_ser_queue << "Borked" << endl;
 					}
-					p_position_1 -> put(pos_1);
-					p_position_2 -> put(pos_2);
+					set_targets ();
 				}
 				break;
 					
@@ -221,6 +239,6 @@ void task_position::run (void)
 		
 		// This is a method we use to cause a task to make one run through its task
 		// loop every N milliseconds and let other tasks run at other times
-		delay_from_for_ms (previousTicks, 50);	
+		delay_from_for_ms (previousTicks, POSITION_PERIOD_MS);	
 	}
 }
\ No newline at end of file
@@ -46,6 +46,12 @@
 
 #include "emstream.h"                       // Header for serial ports and devices
 #include "adc.h"							// Header for A/D converter class
+#include "task_sensor.h"                    // Header for the sensor task
+
+/** The time in milliseconds between runs of the position task. Each run moves the 
+ *  gun one step of its search or aim, using the newest sensor reading if it hasn't
+ *  been used before. */
+#define POSITION_PERIOD_MS  50
 
 //-------------------------------------------------------------------------------------
 /** @brief   This task controls and reads an encoder
@@ -65,7 +71,7 @@ class task_position : public TaskBase
 		// Maximum position for hinge before rack falls out
 		uint16_t hinge_limit;
 		
-		// Threshold for light detection
+		// Signal to noise ratio for light detection, times FILTER_SNR_ONE
 		uint16_t threshold;
 		
 		// Limits for directions
@@ -82,12 +88,23 @@ class task_position : public TaskBase
 		// Center tolerance
 		uint8_t tol;
 		
+		// The newest frame of sensor readings, and the number of the last one used
+		sensor_frame_t frame;
+		uint16_t last_sequence;
+		
+		// Whether this run through the loop has a new frame which isn't stale
+		bool fresh;
+		
 		// Each phototransistor in the array labeled as Row_Column
 		uint16_t high_left;
 		uint16_t high_right;
 		uint16_t center;
 		uint16_t low_left;
 		uint16_t low_right;
+		
+		// This method sends new reference positions and clears the done flags at once
+		void set_targets (void);
+		
 	public:
 		// This constructor creates a generic task of which many copies can be made
 		task_position (const char*, unsigned portBASE_TYPE, size_t, emstream*);
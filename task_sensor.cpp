@@ -30,6 +30,13 @@
 #include "shares.h"                         // Shared inter-task communications
 #include <math.h>                           // Includes math library
 
+//-------------------------------------------------------------------------------------
+/** The A/D channel of each phototransistor, in the order of the @c sensor_index_t
+ *  names.
+ */
+
+const uint8_t SENSOR_CHANNELS[SENSOR_COUNT] = { 0, 4, 3, 2, 1 };
+
 //-------------------------------------------------------------------------------------
 /** This constructor creates a task which reads input from a phototransistor array  
  *  The main job of this constructor is to call the constructor of parent class 
@@ -53,8 +60,8 @@ task_sensor::task_sensor (const char* a_name, unsigned portBASE_TYPE a_priority,
 
 //-------------------------------------------------------------------------------------
 /** This method is called once by the RTOS scheduler. The A/D converters associated with each 
- *  phototransistor are oversampled on each pass. The readings are stored in shared variables for use
- *  in other tasks.
+ *  phototransistor are oversampled on each pass. The readings are published together as
+ *  one frame for use in other tasks.
  */
 
 void task_sensor::run (void)
@@ -62,31 +69,66 @@ void task_sensor::run (void)
 	// Make a variable which will hold times to use for precise task scheduling
 	TickType_t previousTicks = xTaskGetTickCount ();
 	
-	// Create an analog to digital converter driver object and a variable in which to
-	// store its output.
-	adc* p_adc = new adc (p_serial);
+	// The A/D converter driver is shared with other tasks, which send it requests in
+	// between the conversions of this task's scan. Here is where its output goes
+	uint16_t readings[SENSOR_COUNT];
+	uint16_t last_pass = 0;
+	uint16_t sequence = 0;
+	TickType_t finished;
+	
+	// The A/D converter scans the sensors under interrupt control, triggered by a
+	// timer, and averages all the conversions of each one made in one period of this
+	// task, so this task never waits for a conversion
+	p_adc->start_scan (SENSOR_CHANNELS, SENSOR_COUNT, SENSOR_SAMPLES);
 	
 	// This is the task loop for the sensor task. This loop runs until the
 	// power is turned off or something equally dramatic occurs
 	for (;;)
 	{
-		// The A/D converter for each sensor is oversampled in these lines
-		center = p_adc -> read_oversampled(0,4);
-		high_left = p_adc -> read_oversampled(4,4);
-		high_right = p_adc -> read_oversampled(3,4);
-		low_left = p_adc -> read_oversampled(2,4);
-		low_right = p_adc -> read_oversampled(1,4);
-		
-		// The A/D readings are stored in shared variables for use in the control loop
-		p_high_left-> put(high_left);
-		p_high_right-> put(high_right);
-		p_center-> put(center);
-		p_low_left-> put(low_left);
-		p_low_right-> put(low_right);
+		// The newest complete scan is filtered into the back of the frame buffer and
+		// published whole, once; until there is one, nothing is published
+		uint16_t pass = p_adc->get_scan (readings, &finished);
+		if (pass != last_pass)
+		{
+			last_pass = pass;
+			sensor_frame_t& frame = p_sensor_frame->back ();
+			for (uint8_t sensor = 0; sensor < SENSOR_COUNT; sensor++)
+			{
+				frame.signal[sensor] = baselines[sensor].put 
+					(filters[sensor].put (readings[sensor]));
+				frame.snr[sensor] = baselines[sensor].snr ();
+			}
+			frame.sequence = ++sequence;
+			frame.time = finished;
+			p_sensor_frame->publish ();
+		}
 
 		// This is a method we use to cause a task to make one run through its task
 		// loop every N milliseconds and let other tasks run at other times
-		delay_from_for_ms (previousTicks, 100);		
+		delay_from_for_ms (previousTicks, SENSOR_PERIOD_MS);		
 	}
 }
 
+
+
+//-------------------------------------------------------------------------------------
+/** This operator prints a frame of sensor readings: its sequence number and time, then
+ *  each sensor's signal and signal to noise ratio, in the order of the 
+ *  @c sensor_index_t names.
+ *  @param   serpt Reference to a serial port to which the printout will be printed
+ *  @param   frame Reference to the frame which is being printed
+ *  @return  A reference to the same serial device on which we write information
+ */
+
+emstream& operator << (emstream& serpt, const sensor_frame_t& frame)
+{
+	serpt << PMS ("Sensor frame ") << frame.sequence << PMS (" at tick ") 
+		  << (uint32_t)frame.time << PMS (":");
+	for (uint8_t sensor = 0; sensor < SENSOR_COUNT; sensor++)
+	{
+		serpt << ' ' << frame.signal[sensor] << '/' << frame.snr[sensor];
+	}
+	serpt << endl;
+
+	return (serpt);
+}
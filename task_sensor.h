@@ -46,11 +46,87 @@
 
 #include "emstream.h"                       // Header for serial ports and devices
 #include "adc.h"							// Header for A/D converter class
+#include "filters.h"                        // Header for integer filter templates
+#include "doublebuffer.h"                   // Header for the double buffer template
+
+/// The number of phototransistors in the sensor array
+#define SENSOR_COUNT  5
+
+/** The time in milliseconds between sensor readings. @c task_position runs less 
+ *  often and only uses the newest reading, each one once. */
+#define SENSOR_PERIOD_MS  10
+
+/** The number of conversions of each sensor which the A/D scan averages into each
+ *  reading; it's however many fit in one period at @c ADC_TRIGGER_HZ. */
+#define SENSOR_SAMPLES  (ADC_TRIGGER_HZ * SENSOR_PERIOD_MS / (1000L * SENSOR_COUNT))
+
+/** With @c -DADC_LOCKIN, the frequency in Hz at which the target's beacon must flash;
+ *  each sensor is converted four times per flash. It's 250 Hz at the default rate. */
+#define SENSOR_BEACON_HZ  (ADC_TRIGGER_HZ / (4L * SENSOR_COUNT))
+
+/// The position of each phototransistor's reading in a scan of the sensor array
+enum sensor_index_t
+{
+	SENSOR_CENTER,
+	SENSOR_HIGH_LEFT,
+	SENSOR_HIGH_RIGHT,
+	SENSOR_LOW_LEFT,
+	SENSOR_LOW_RIGHT
+};
+
+/** The number of readings in the median filter which throws out spikes; a spike 
+ *  lasting less than half this many sensor periods is never seen. */
+#define SENSOR_MEDIAN_LENGTH  3
+
+/** The shift of the low pass filter after the median filter; its time constant is 
+ *  about 2 to this power sensor periods. */
+#define SENSOR_IIR_SHIFT  2
+
+/// The filter each sensor's readings go through, spike rejection then low pass
+typedef filter_chain<median_filter<SENSOR_MEDIAN_LENGTH>, iir_filter<SENSOR_IIR_SHIFT> >
+	sensor_filter_t;
+
+/** The signal to noise ratio, times @c FILTER_SNR_ONE, at which a sensor is taken to
+ *  see a target. The noise is a mean absolute deviation, so this is about five 
+ *  standard deviations, which noise alone almost never reaches. */
+#define SENSOR_DETECT_SNR  (6 * FILTER_SNR_ONE)
+
+/** The filter which tracks each sensor's ambient light level and noise. The baseline
+ *  follows the light in the room with a time constant of about 5 seconds and the 
+ *  noise floor with about 1.3 seconds; while a sensor sees a target, both are held 
+ *  for up to 10 seconds. */
+typedef baseline_filter<9, 7, 10, SENSOR_DETECT_SNR> sensor_baseline_t;
+
+// The A/D channel of each phototransistor, in the order of the names above
+extern const uint8_t SENSOR_CHANNELS[SENSOR_COUNT];
+
+/** A frame of sensor readings older than this many milliseconds is stale; the sensor
+ *  task has stopped publishing, or missed several of its periods. */
+#define SENSOR_STALE_MS  (3 * SENSOR_PERIOD_MS)
+
+//-------------------------------------------------------------------------------------
+/** @brief   This structure holds one filtered scan of the whole sensor array.
+ *  @details It is published all at once through @c p_sensor_frame, so every reading 
+ *           in it comes from the same scan. The sequence number goes up by one for
+ *           each new scan, so a task can tell whether it has already used a frame and
+ *           whether any were missed; a sequence number of 0 means there hasn't been a
+ *           scan yet.
+ */
+
+struct sensor_frame_t
+{
+	uint16_t    sequence;                   ///< Number of the scan, counting from 1
+	TickType_t  time;                       ///< RTOS tick count when it was finished
+	uint16_t    signal[SENSOR_COUNT];       ///< Each reading above ambient light
+	uint16_t    snr[SENSOR_COUNT];          ///< Each signal to noise ratio
+};
 
 //-------------------------------------------------------------------------------------
 /** @brief   This task reads input from the phototransistor sensor array
- *  @details The A/D converters for each phototransistor are read and stored in shared
- *           data space for use in other tasks.
+ *  @details The A/D converters for each phototransistor are read and filtered. The 
+ *           ambient light level is taken away from each reading, and what's left and
+ *           its ratio to the noise are published together as one @c sensor_frame_t
+ *           for use in other tasks.
  */
 
 class task_sensor : public TaskBase
@@ -59,13 +135,12 @@ class task_sensor : public TaskBase
 		// No private variables or methods for this class
 
 	protected:
-		// Each phototransistor in the array is labeled based on physical location
-		// in the array.
-		uint16_t high_left;
-		uint16_t high_right;
-		uint16_t center;
-		uint16_t low_left;
-		uint16_t low_right;
+		/// A filter for each sensor, in the order of the @c sensor_index_t names
+		sensor_filter_t filters[SENSOR_COUNT];
+		
+		/// An ambient light tracker for each sensor, in the same order
+		sensor_baseline_t baselines[SENSOR_COUNT];
+		
 
 	public:
 		// This constructor creates a generic task of which many copies can be made
@@ -79,4 +154,7 @@ class task_sensor : public TaskBase
 // a part of class task_sensor, but it operates on objects of class task_sensor
 emstream& operator << (emstream&, task_sensor&);
 
+// This operator prints a frame of sensor readings
+emstream& operator << (emstream&, const sensor_frame_t&);
+
 #endif // _TASK_SENSOR_H_
@@ -31,6 +31,9 @@
 
 #include "task_user.h"                      // Header for this file
 #include "math.h"                           // Mathmatical operators library
+#include "encoder_bench.h"                  // Encoder decoder benchmark
+#include "task_sensor.h"                    // Header for the sensor frames
+#include "pid.h"                            // Fixed point PID benchmark
 
 #define brake_1 0                           // These defines help make the code more
 #define free_1  1							// readable. Enumeration data types were 
@@ -87,10 +90,6 @@ void task_user::run (void)
 	// task does interesting things such as diagnostic printouts
 	*p_serial << PMS ("Press 'h' or '?' for help") << endl;
 	
-	// Constructer call for the encoder driver
-	Encoder* p_encoder_2 = new Encoder (p_serial, &PORTE, &DDRE, &PINE, ISC60, ISC61, 6, ISC70, 
-									  ISC71, 7);
-
 	// This is an infinite loop; it runs until the power is turned off. There is one 
 	// such loop inside the code for each task
 	for (;;)
@@ -141,6 +140,20 @@ void task_user::run (void)
 							print_task_stacks (p_serial);
 							break;
 
+						#ifdef ENCODER_BENCH
+							// The 'b' command benchmarks the encoder decoder
+							case ('b'):
+								encoder_bench_run (p_serial);
+								break;
+						#endif
+
+						#ifdef PID_BENCH
+							// The 'c' command benchmarks the control law
+							case ('c'):
+								pid_bench_run (p_serial);
+								break;
+						#endif
+
 						// The 'h' command is a plea for help; '?' works also
 						case ('h'):
 						case ('?'):
@@ -223,14 +236,14 @@ void task_user::run (void)
 							*p_serial << PMS ("Motor 1 is braking (press ? or h for help menu)") << endl;
 							number_entered = 0;
 							transition_to (0);
-							p_mode -> put (brake_1);
+							p_mode_1 -> put (brake_1);
 							break;
 			
 						// The 'f' command asks to freewheel motor 1
 						case('f'):
 							*p_serial << PMS ("Motor 1 is Freewheeling (press ? or h for help menu)") << endl;
 							transition_to (0);
-							p_mode->put (free_1);
+							p_mode_1->put (free_1);
 							break;
 				
 						// The 'r' command asks to run motor 1
@@ -265,14 +278,14 @@ void task_user::run (void)
 							*p_serial << PMS ("Motor 2 is braking (press ? or h for help menu)") << endl;
 							number_entered = 0;
 							transition_to (0);
-							p_mode -> put (brake_2);
+							p_mode_2 -> put (brake_2);
 							break;
 				
 						// The 'f' command asks to freewheel motor 2
 						case('f'):
 							*p_serial << PMS ("Motor 2 is Freewheeling (press ? or h for help menu)") << endl;
 							transition_to (0);
-							p_mode->put (free_2);
+							p_mode_2->put (free_2);
 							break;
 					
 						// The 'r' command asks to run motor 2
@@ -310,12 +323,12 @@ void task_user::run (void)
 							if(motor == 1)
 							{
 								p_share_1->put (number_entered);
-								p_mode->put(power_1);
+								p_mode_1->put(power_1);
 							}
 							else
 							{
 								p_share_2->put (number_entered);
-								p_mode->put(power_2);
+								p_mode_2->put(power_2);
 							}
 							break;
 						
@@ -328,12 +341,12 @@ void task_user::run (void)
 							if(motor == 1)
 							{
 								p_share_1->put (number_entered);
-								p_mode->put(power_1);
+								p_mode_1->put(power_1);
 							}
 							else
 							{
 								p_share_2->put (number_entered);
-								p_mode->put(power_2);
+								p_mode_2->put(power_2);
 							}
 							break;
 						
@@ -360,7 +373,7 @@ void task_user::run (void)
 						// The 'z' command zeroes the encoder
 						case ('z'):
 							*p_serial << PMS ("Encoder is zeroed (press ? or h for help menu)") << endl;
-							p_encoder_2->clear_count(2);
+							BaseEncoder::clear_count ();
 							transition_to (0);
 							break;
 							
@@ -409,7 +422,7 @@ void task_user::run (void)
 						
 						*p_serial << endl << PMS ("Encoder Set: ") 
 								  << big_number_entered << endl;
-						p_encoder_2->set_count(2,big_number_entered);
+						BaseEncoder::set_count (big_number_entered);
 						transition_to (0);
 					}
 					else
@@ -462,6 +475,12 @@ void task_user::print_help_message (void)
 	*p_serial << PMS ("  t:     Show the time right now") << endl;
 	*p_serial << PMS ("  s:     Version and setup information") << endl;
 	*p_serial << PMS ("  d:     Stack dump for tasks") << endl;
+	#ifdef ENCODER_BENCH
+		*p_serial << PMS ("  b:     Benchmark the encoder decoder") << endl;
+	#endif
+	#ifdef PID_BENCH
+		*p_serial << PMS ("  c:     Benchmark the fixed point PID") << endl;
+	#endif
 	*p_serial << PMS ("  Ctl-C: Reset the AVR") << endl;
 	*p_serial << PMS ("  h:     HALP!") << endl;
 		
@@ -510,6 +529,8 @@ void task_user::print_direction_message (void)
  *    \li The name, status, priority, and free stack space of each task
  *    \li Processor cycles used by each task
  *    \li Amount of heap space free and setting of RTOS tick timer
+ *    \li The newest frame of IR sensor readings
+ *    \li Illegal transition statistics for each encoder
  */
 
 void task_user::show_status (void)
@@ -532,5 +553,16 @@ void task_user::show_status (void)
 	print_task_list (p_serial);
 	*p_serial << endl;
 	print_all_shares (p_serial);
+	
+	// The sensor readings are in one frame rather than shares
+	sensor_frame_t frame;
+	p_sensor_frame->get (frame);
+	*p_serial << frame;
+
+	// Each encoder's illegal transition statistics show whether counts are being lost
+	*p_serial << endl << PMS ("Gun encoder ");
+	GunEncoder::print_stats (*p_serial);
+	*p_serial << PMS ("Base encoder ");
+	BaseEncoder::print_stats (*p_serial);
 }
 
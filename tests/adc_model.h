@@ -0,0 +1,59 @@
+//======================================================================================
+/** @file adc_model.h
+ *    This file contains a model of the A/D converter for the host tests of the A/D
+ *    driver. A conversion is of whichever channel the stand-in \c ADMUX selects when
+ *    it's made; its result is put in the stand-in \c ADC register and the driver's 
+ *    own ISR is run, as the conversion complete interrupt would be.
+ *
+ *  Revisions:
+ *    @li 10-16-2026 Original file
+ *
+ *  License:
+ *    This file is copyright 2026 by its authors and released under the Lesser GNU
+ *    Public License, version 2, as the rest of this project is. It is intended for
+ *    educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//======================================================================================
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _ADC_MODEL_H_
+#define _ADC_MODEL_H_
+
+#include <avr/io.h>                         // Stand-in A/D registers
+
+// The ISR which adc.cpp makes for the conversion complete interrupt
+extern "C" void ADC_vect (void);
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Returns the channel which the next conversion will be made of.
+ *  @return  The single-ended channel selected in @c ADMUX, from 0 to 7
+ */
+
+inline uint8_t adc_channel (void)
+{
+	return (ADMUX & 0x07);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Finishes a conversion with the given result and runs the A/D's ISR.
+ *  @param   reading The result of the conversion, from 0 to 1023
+ */
+
+inline void adc_convert (uint16_t reading)
+{
+	ADC = reading;
+	ADC_vect ();
+}
+
+#endif // _ADC_MODEL_H_
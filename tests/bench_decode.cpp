@@ -0,0 +1,204 @@
+//======================================================================================
+/** @file bench_decode.cpp
+ *    This file contains a host benchmark of the encoder decoders. It times the branch
+ *    decoder the driver used before, the table lookup alone, and the driver's whole 
+ *    ISR on the same stream of edges. The times are the host's, so only the ratios 
+ *    mean much; the AVR's cycles per edge come from the 'b' command of a build with
+ *    \c -DENCODER_BENCH.
+ *
+ *  Revisions:
+ *    @li 10-16-2026 Original file
+ *
+ *  License:
+ *    This file is copyright 2026 by its authors and released under the Lesser GNU
+ *    Public License, version 2, as the rest of this project is. It is intended for
+ *    educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//======================================================================================
+
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "encoder_driver.h"                 // The encoder driver being timed
+#include "branch_decoder.h"                 // The decoder it replaced
+#include "time_model.h"                     // The clock it time stamps edges with
+#include "host.h"                           // Stand-in registers
+
+// The ISR which encoder_driver.cpp makes for the gun encoder
+extern "C" void INT4_vect (void);
+
+/// The number of edges in the stream each decoder is timed on
+#define BENCH_EDGES  (1L << 20)
+
+/// Each decoder is timed this many times and the fastest run is kept
+#define BENCH_RUNS   20
+
+/// The stream of pin register values, a random walk with a few missed edges
+static uint8_t edges[BENCH_EDGES];
+
+/// The results go here so that the compiler can't throw the work away
+static volatile uint32_t sink;
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   This class opens up the gun encoder's ISR state for the benchmark.
+ */
+
+class gun_bench : public GunEncoder
+{
+	public:
+		using GunEncoder::read_state;
+
+		/// Puts the encoder back to a count of zero with the glitch filter off
+		static void reset (void)
+		{
+			memset (&state, 0, sizeof (state));
+			state.state_old = read_state (edges[BENCH_EDGES - 1]);
+		}
+};
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Returns the time since a starting time in nanoseconds.
+ */
+
+static double nanoseconds_since (std::chrono::steady_clock::time_point start)
+{
+	return (std::chrono::duration<double, std::nano> 
+		(std::chrono::steady_clock::now () - start).count ());
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Times the branch decoder over the whole stream once.
+ *  @return  The time taken per edge in nanoseconds
+ */
+
+static double time_branch (void)
+{
+	uint32_t count = 0;
+	uint32_t errors = 0;
+	uint8_t old_pins = edges[BENCH_EDGES - 1];
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+
+	for (long edge = 0; edge < BENCH_EDGES; edge++)
+	{
+		PINE = edges[edge];
+		uint8_t pins = PINE;
+		branch_decode (pins, old_pins, PE4, PE5, count, errors);
+		old_pins = pins;
+	}
+	double time = nanoseconds_since (start) / BENCH_EDGES;
+	sink = count + errors;
+	return (time);
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Times the table lookup alone over the whole stream once.
+ *  @return  The time taken per edge in nanoseconds
+ */
+
+static double time_table (void)
+{
+	int32_t count = 0;
+	uint32_t errors = 0;
+	uint8_t state_old = gun_bench::read_state (edges[BENCH_EDGES - 1]);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+
+	for (long edge = 0; edge < BENCH_EDGES; edge++)
+	{
+		PINE = edges[edge];
+		uint8_t state = gun_bench::read_state (PINE);
+		int8_t delta = encoder_decode (state_old, state);
+		count += delta;
+		errors += !delta;
+		state_old = state;
+	}
+	double time = nanoseconds_since (start) / BENCH_EDGES;
+	sink = count + errors;
+	return (time);
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Times the driver's whole ISR, with the period ring and error statistics,
+ *           over the whole stream once.
+ *  @return  The time taken per edge in nanoseconds
+ */
+
+static double time_isr (void)
+{
+	gun_bench::reset ();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+
+	for (long edge = 0; edge < BENCH_EDGES; edge++)
+	{
+		PINE = edges[edge];
+		time_advance (50);
+		INT4_vect ();
+	}
+	double time = nanoseconds_since (start) / BENCH_EDGES;
+	sink = GunEncoder::view_count ();
+	return (time);
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Runs a timing function several times and returns its fastest time.
+ */
+
+static double fastest (double (*timer)(void))
+{
+	double best = timer ();
+
+	for (uint8_t run = 1; run < BENCH_RUNS; run++)
+	{
+		double time = timer ();
+		if (time < best)
+		{
+			best = time;
+		}
+	}
+	return (best);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Times the decoders and prints the results.
+ */
+
+int main (void)
+{
+	static const uint8_t FORWARD[4] = { 0x00, 0x02, 0x03, 0x01 };
+	uint8_t phase = 0;
+
+	// Mostly forward, some back and now and then a missed edge, so the branches in
+	// the old decoder can't all be predicted
+	srand (405);
+	for (long edge = 0; edge < BENCH_EDGES; edge++)
+	{
+		uint8_t choice = rand () % 32;
+		phase = (phase + (choice < 20 ? 1 : (choice < 31 ? 3 : 2))) & 3;
+		edges[edge] = ((FORWARD[phase] & 0x02) ? (1 << PE4) : 0) 
+					  | ((FORWARD[phase] & 0x01) ? (1 << PE5) : 0);
+	}
+
+	double branch = fastest (time_branch);
+	double table = fastest (time_table);
+	double isr = fastest (time_isr);
+
+	printf ("bench_decode: host ns per edge, fastest of %d runs of %ld edges\n", 
+			BENCH_RUNS, BENCH_EDGES);
+	printf ("  branch decoder  %6.2f\n", branch);
+	printf ("  table lookup    %6.2f  (%.1fx faster than the branch decoder)\n", 
+			table, branch / table);
+	printf ("  whole ISR       %6.2f\n", isr);
+	return (0);
+}
@@ -0,0 +1,387 @@
+//======================================================================================
+/** @file bench_edges.cpp
+ *    This file contains a host harness which finds the highest edge rate at which the
+ *    encoder driver counts correctly. A quadrature waveform at a steady rate is played
+ *    into the stand-in \c PINE, and a model of the AVR's external interrupts decides
+ *    when the driver's real ISR runs and what it reads: each edge sets its channel's
+ *    interrupt flag, the ISR starts once the processor is free, reads the pins a few 
+ *    cycles later and keeps the processor for a set number of cycles. In batched mode
+ *    the queued edges are drained every millisecond, as \c task_encoder does, and the
+ *    drain's cycles are spent whenever no ISR is running. The old ISR, whose decoding
+ *    is kept in \c branch_decoder.h, is run through the same model so the rates at
+ *    which each decoder starts to miscount can be compared. The model knows nothing 
+ *    of the AVR's instructions, so the cycle costs are inputs: the defaults are
+ *    estimates, and the cycles per edge printed by the on-target 'b' command of a 
+ *    build with \c -DENCODER_BENCH can be given on the command line instead. This 
+ *    isn't cycle accurate; a simulator such as simavr would be, but none is used.
+ *
+ *  Revisions:
+ *    @li 10-16-2026 Original file
+ *
+ *  License:
+ *    This file is copyright 2026 by its authors and released under the Lesser GNU
+ *    Public License, version 2, as the rest of this project is. It is intended for
+ *    educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//======================================================================================
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "encoder_driver.h"                 // The encoder driver being run
+#include "encoder_bench.h"                  // The on-target benchmark's entry estimate
+#include "branch_decoder.h"                 // The old ISR's decoding
+#include "time_model.h"                     // The clock it time stamps edges with
+#include "host.h"                           // Stand-in registers
+
+// The ISR which encoder_driver.cpp makes for the gun encoder
+extern "C" void INT4_vect (void);
+
+/** An estimate of the cycles the ISR's decoding takes, not counting its entry and
+ *  exit; the 'b' command measures it on the target. Either way the time stamp takes
+ *  about 35 of them, since the RTOS tick count is read with a function call. */
+#ifdef ENCODER_BATCHED
+	#define BENCH_BODY_CYCLES  60
+#else
+	#define BENCH_BODY_CYCLES  155
+#endif
+
+/** An estimate of the cycles the old ISR's decoding took: it copied five task shares,
+ *  two of them 32 bits, and shifted by pin numbers held in variables, which the AVR 
+ *  does one bit at a time. */
+#define BENCH_BRANCH_CYCLES  350
+
+/// An estimate of the cycles \c drain() takes for each queued edge
+#define BENCH_DRAIN_CYCLES  140
+
+/** An estimate of the cycles from an edge to the ISR reading the pins: the interrupt
+ *  response, the jump from the vector and the registers pushed before the read. */
+#define BENCH_READ_CYCLES   30
+
+/// The time between drains in batched mode, one millisecond as in \c task_encoder
+#define BENCH_DRAIN_PERIOD  (F_CPU / 1000)
+
+/// The number of edges played at each rate
+#define BENCH_EDGES         4000
+
+/// The processor cycles in each time stamp tick
+#define BENCH_TICK_CYCLES   (F_CPU / ENCODER_TIMER_HZ)
+
+/// The channel states in the positive direction; channel A is bit 1 and B is bit 0
+static const uint8_t FORWARD[4] = { 0x00, 0x02, 0x03, 0x01 };
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   This structure holds the cycle costs which the model is run with.
+ */
+
+struct bench_costs_t
+{
+	uint16_t isr;                           ///< Cycles the whole ISR keeps the CPU
+	uint16_t read;                          ///< Cycles from its start to the pin read
+	uint16_t drain;                         ///< Cycles to drain each queued edge
+};
+
+/// @brief   This structure holds the outcome of playing edges at one rate.
+struct bench_result_t
+{
+	int32_t   lost;                         ///< Edges played less the final count
+	uint32_t  errors;                       ///< Illegal transitions seen
+	uint32_t  glitches;                     ///< Edges dropped as noise
+	uint16_t  overflows;                    ///< Edges dropped from a full queue
+	double    load;                         ///< Fraction of the CPU the encoder took
+};
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   This class opens up the gun encoder's state so the harness can reset it.
+ */
+
+class gun_bench : public GunEncoder
+{
+	public:
+		/// Puts the encoder back to a count of zero with both channels low
+		static void reset (uint16_t min_interval)
+		{
+			memset (&state, 0, sizeof (state));
+			memset (&speed, 0, sizeof (speed));
+			#ifdef ENCODER_BATCHED
+				memset (&queue, 0, sizeof (queue));
+			#endif
+			state.min_interval = min_interval;
+		}
+
+		/// Returns the number of edges waiting in the queue
+		static uint8_t queued (void)
+		{
+			#ifdef ENCODER_BATCHED
+				return ((uint8_t)(queue.head - queue.tail) & (ENCODER_QUEUE_SIZE - 1));
+			#else
+				return (0);
+			#endif
+		}
+};
+
+//-------------------------------------------------------------------------------------
+/** @brief   This structure describes a decoder which the harness can play edges into.
+ */
+
+struct bench_decoder_t
+{
+	const char*  name;                      ///< The name printed with its results
+	void (*reset) (uint16_t min_interval);  ///< Puts it back to a count of zero
+	void (*isr) (void);                     ///< Its interrupt service routine
+	void (*finish) (bench_result_t& result); ///< Decodes what's left, fills in results
+	bool         batched;                   ///< True if its edges are drained later
+	bool         filtered;                  ///< True if it has a glitch filter
+};
+
+#ifndef ENCODER_BATCHED
+	/// The old ISR's previous pin reading, count and error count
+	static uint8_t branch_state_old;
+	static uint32_t branch_count;
+	static uint32_t branch_errors;
+
+	/// Puts the old ISR's state back to a count of zero with both channels low
+	static void branch_reset (uint16_t min_interval)
+	{
+		branch_state_old = 0;
+		branch_count = 0;
+		branch_errors = 0;
+	}
+
+	/// Runs the old ISR's decoding on the gun encoder's pins
+	static void branch_isr (void)
+	{
+		uint8_t STATE = PINE;
+
+		branch_decode (STATE, branch_state_old, PE4, PE5, branch_count, branch_errors);
+		branch_state_old = STATE;
+	}
+
+	/// Fills in the results of the old ISR, which has no glitch filter or queue
+	static void branch_finish (bench_result_t& result)
+	{
+		result.lost = (int32_t)BENCH_EDGES - (int32_t)branch_count;
+		result.errors = branch_errors;
+		result.glitches = 0;
+		result.overflows = 0;
+	}
+#endif // ENCODER_BATCHED
+
+/// Drains the gun encoder's queue and fills in its results
+static void driver_finish (bench_result_t& result)
+{
+	GunEncoder::drain ();
+	encoder_errors_t stats = GunEncoder::error_stats ();
+	result.lost = (int32_t)BENCH_EDGES - GunEncoder::view_count ();
+	result.errors = stats.count;
+	result.glitches = stats.glitches;
+	result.overflows = GunEncoder::overflow_count ();
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Plays a steady waveform into a decoder and models when its ISR and drain
+ *           run.
+ *  @param   decoder The decoder which the edges are played into
+ *  @param   rate The edge rate in edges per second
+ *  @param   min_interval The glitch filter setting in time stamp ticks
+ *  @param   costs The cycle costs of the ISR and the drain
+ *  @return  How well the edges were counted
+ */
+
+static bench_result_t play (const bench_decoder_t& decoder, double rate, 
+							uint16_t min_interval, const bench_costs_t& costs)
+{
+	const uint64_t NEVER = ~(uint64_t)0;
+	double period = F_CPU / rate;
+	uint16_t played = 0;
+	uint8_t phase = 0;
+	uint8_t flags = 0;                      // Interrupt flags, bit 0 A and bit 1 B
+	uint64_t now = 0;
+	uint64_t next_edge = (uint64_t)period;
+	uint64_t busy_until = 0;                // When the CPU is next free
+	uint64_t read_at = NEVER;               // When the running ISR reads the pins
+	uint64_t busy = 0;                      // Cycles spent in the ISR and drain
+	uint32_t backlog = 0;                   // Drained edges whose cycles are owed
+	uint64_t next_drain = decoder.batched ? BENCH_DRAIN_PERIOD : NEVER;
+
+	PINE = 0;
+	decoder.reset (min_interval);
+
+	while (played < BENCH_EDGES || now < busy_until || read_at != NEVER || backlog)
+	{
+		// Go on to whatever happens next; a free CPU with work waiting starts it now
+		uint64_t next = (played < BENCH_EDGES) ? next_edge : NEVER;
+		if (read_at < next)
+		{
+			next = read_at;
+		}
+		if (busy_until > now)
+		{
+			next = (busy_until < next) ? busy_until : next;
+		}
+		else if (flags || backlog)
+		{
+			next = now;
+		}
+		else if (next_drain < next)
+		{
+			next = next_drain;
+		}
+		now = (next > now) ? next : now;
+
+		// An edge changes one channel and sets its interrupt flag
+		if (played < BENCH_EDGES && now >= next_edge)
+		{
+			uint8_t old_state = FORWARD[phase];
+			phase = (phase + 1) & 3;
+			PINE = ((FORWARD[phase] & 0x02) ? (1 << PE4) : 0)
+				   | ((FORWARD[phase] & 0x01) ? (1 << PE5) : 0);
+			flags |= ((old_state ^ FORWARD[phase]) & 0x02) ? 0x01 : 0x02;
+			played++;
+			next_edge = (uint64_t)(period * (played + 1));
+		}
+
+		// The running ISR reads the pins and the time stamp
+		if (now >= read_at)
+		{
+			time_set ((uint16_t)(now / BENCH_TICK_CYCLES));
+			decoder.isr ();
+			read_at = NEVER;
+		}
+
+		// Once the CPU is free, pending interrupts come first, then the drain task
+		if (now >= busy_until)
+		{
+			if (flags)
+			{
+				flags &= (flags & 0x01) ? 0x02 : 0x01;
+				read_at = now + costs.read;
+				busy_until = now + costs.isr;
+				busy += costs.isr;
+			}
+			else if (backlog)
+			{
+				backlog--;
+				busy_until = now + costs.drain;
+				busy += costs.drain;
+			}
+			else if (decoder.batched && now >= next_drain)
+			{
+				backlog += gun_bench::queued ();
+				GunEncoder::drain ();
+				next_drain += BENCH_DRAIN_PERIOD;
+			}
+		}
+	}
+
+	bench_result_t result;
+	decoder.finish (result);
+	result.load = (double)busy / (double)now;
+	return (result);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Plays rates from 5000 to 300000 edges per second and prints the outcome.
+ *  @param   decoder The decoder which the edges are played into
+ *  @param   min_interval The glitch filter setting in time stamp ticks
+ *  @param   costs The cycle costs of the ISR and the drain
+ *  @return  The highest rate before the first at which any edge was miscounted
+ */
+
+static uint32_t sweep (const bench_decoder_t& decoder, uint16_t min_interval, 
+					   const bench_costs_t& costs)
+{
+	uint32_t good = 0;
+	bool failed = false;
+
+	printf ("  %s, ISR %u cycles", decoder.name, costs.isr);
+	if (decoder.batched)
+	{
+		printf (", drain %u cycles per edge", costs.drain);
+	}
+	if (decoder.filtered)
+	{
+		printf (", glitch filter %u ticks", min_interval);
+	}
+	printf ("\n");
+	printf ("    edges/s  CPU%%   lost  errors  glitches  overflows\n");
+	for (uint32_t rate = 5000; rate <= 300000; rate += 5000)
+	{
+		bench_result_t result = play (decoder, rate, min_interval, costs);
+		bool bad = result.lost || result.errors || result.overflows;
+
+		if (!bad && !failed)
+		{
+			good = rate;
+		}
+		failed = failed || bad;
+		if (rate % 25000 == 0 || (bad && rate - good <= 5000))
+		{
+			printf ("    %7lu %5.1f %6ld %7lu %9lu %10u\n", (unsigned long)rate, 
+					100.0 * result.load, (long)result.lost, 
+					(unsigned long)result.errors, (unsigned long)result.glitches, 
+					result.overflows);
+		}
+	}
+	return (good);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Runs the sweeps with the costs given on the command line, if any.
+ *  @details The arguments are the ISR's decoding cycles per edge, as the 'b' command 
+ *           prints them, the drain's cycles per edge in batched mode, and the old 
+ *           ISR's decoding cycles. The old ISR is only run in the direct build, as it
+ *           has no batched form.
+ */
+
+int main (int argc, char** argv)
+{
+	bench_costs_t costs;
+
+	costs.isr = ENCODER_BENCH_ENTRY_CYCLES 
+				+ ((argc > 1) ? atoi (argv[1]) : BENCH_BODY_CYCLES);
+	costs.read = BENCH_READ_CYCLES;
+	costs.drain = (argc > 2) ? atoi (argv[2]) : BENCH_DRAIN_CYCLES;
+
+	#ifdef ENCODER_BATCHED
+		const bench_decoder_t driver = 
+			{ "table, batched", gun_bench::reset, INT4_vect, driver_finish, true, true };
+	#else
+		const bench_decoder_t driver = 
+			{ "table, direct", gun_bench::reset, INT4_vect, driver_finish, false, true };
+	#endif
+
+	printf ("bench_edges: cycle costs are estimates unless given on the command line\n");
+	uint32_t filtered = sweep (driver, ENCODER_MIN_EDGE_TICKS, costs);
+	uint32_t unfiltered = sweep (driver, 0, costs);
+	printf ("  %s counts correctly up to %lu edges/s with the glitch filter, "
+			"%lu without\n", driver.name, (unsigned long)filtered, 
+			(unsigned long)unfiltered);
+
+	#ifndef ENCODER_BATCHED
+		const bench_decoder_t branch = 
+			{ "old branch ISR", branch_reset, branch_isr, branch_finish, false, false };
+
+		costs.isr = ENCODER_BENCH_ENTRY_CYCLES 
+					+ ((argc > 3) ? atoi (argv[3]) : BENCH_BRANCH_CYCLES);
+		uint32_t old = sweep (branch, 0, costs);
+		printf ("  %s counts correctly up to %lu edges/s\n", branch.name, 
+				(unsigned long)old);
+	#endif
+
+	return (0);
+}
@@ -0,0 +1,178 @@
+//======================================================================================
+/** @file bench_filters.cpp
+ *    This file contains a host benchmark of the sensor filters. Each filter which 
+ *    @c task_sensor uses, and the whole chain each sensor's readings go through, is 
+ *    timed on the same stream of noisy readings with spikes in it. The results are 
+ *    host nanoseconds and, on x86 hosts, time stamp counter cycles per sample; they 
+ *    compare the filters with each other, not with what the AVR takes.
+ *
+ *  Revisions:
+ *    @li 10-16-2026 Original file
+ *
+ *  License:
+ *    This file is copyright 2026 by its authors and released under the Lesser GNU
+ *    Public License, version 2, as the rest of this project is. It is intended for
+ *    educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//======================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+#if defined (__x86_64__) || defined (__i386__)
+	#include <x86intrin.h>                  // The time stamp counter
+	#define BENCH_HAS_TSC
+#endif
+
+#include "task_sensor.h"                    // The filters the sensor task uses
+#include "host.h"                           // Stand-in registers
+
+/// The number of readings each filter is timed on, spread over all the sensors
+#define BENCH_SAMPLES  (1L << 20)
+
+/// Each filter is timed this many times and the fastest run is kept
+#define BENCH_RUNS     20
+
+/// The stream of readings, a slowly moving level with noise and now and then a spike
+static uint16_t samples[BENCH_SAMPLES];
+
+/// The results go here so that the compiler can't throw the work away
+static volatile uint32_t sink;
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   This structure holds the time a filter took per sample.
+ */
+
+struct bench_time_t
+{
+	double nanoseconds;                     ///< Host time per sample
+	double cycles;                          ///< Time stamp counter cycles per sample
+};
+
+//-------------------------------------------------------------------------------------
+/** @brief   This filter runs each sample through a sensor's whole chain: the spike 
+ *           and low pass filters, then the baseline, whose signal to noise ratio is 
+ *           read as @c task_sensor reads it.
+ */
+
+class sensor_pipeline
+{
+	protected:
+		sensor_filter_t   filter;           ///< The spike and low pass filters
+		sensor_baseline_t baseline;         ///< The ambient light tracker
+
+	public:
+		/// Puts a sample through the chain and returns its signal plus its ratio
+		uint16_t put (uint16_t sample)
+		{
+			uint16_t signal = baseline.put (filter.put (sample));
+			return (signal + baseline.snr ());
+		}
+};
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Times one kind of filter over the whole stream once.
+ *  @details There is one filter for each sensor and the readings are dealt out to
+ *           them in turn, as the sensor task does with each scan.
+ *  @param   FILTER The filter class being timed
+ *  @return  The time taken per sample
+ */
+
+template <class FILTER>
+static bench_time_t time_once (void)
+{
+	FILTER filters[SENSOR_COUNT];
+	uint32_t total = 0;
+	bench_time_t time;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+	#ifdef BENCH_HAS_TSC
+		uint64_t first = __rdtsc ();
+	#endif
+	for (long sample = 0; sample < BENCH_SAMPLES; sample += SENSOR_COUNT)
+	{
+		for (uint8_t sensor = 0; sensor < SENSOR_COUNT; sensor++)
+		{
+			total += filters[sensor].put (samples[sample + sensor]);
+		}
+	}
+	#ifdef BENCH_HAS_TSC
+		time.cycles = (double)(__rdtsc () - first) / BENCH_SAMPLES;
+	#else
+		time.cycles = 0.0;
+	#endif
+	time.nanoseconds = std::chrono::duration<double, std::nano> 
+		(std::chrono::steady_clock::now () - start).count () / BENCH_SAMPLES;
+	sink = total;
+	return (time);
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Times a filter several times and prints its fastest time.
+ *  @param   FILTER The filter class being timed
+ *  @param   name The name printed with the results
+ */
+
+template <class FILTER>
+static void time_filter (const char* name)
+{
+	bench_time_t best = time_once<FILTER> ();
+
+	for (uint8_t run = 1; run < BENCH_RUNS; run++)
+	{
+		bench_time_t time = time_once<FILTER> ();
+		if (time.nanoseconds < best.nanoseconds)
+		{
+			best = time;
+		}
+	}
+	#ifdef BENCH_HAS_TSC
+		printf ("  %-22s %6.2f %8.1f\n", name, best.nanoseconds, best.cycles);
+	#else
+		printf ("  %-22s %6.2f\n", name, best.nanoseconds);
+	#endif
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Times the filters and prints the results.
+ */
+
+int main (void)
+{
+	srand (415);
+	for (long sample = 0; sample < BENCH_SAMPLES; sample++)
+	{
+		uint16_t level = 300 + (sample / 4096) % 200;
+		uint16_t reading = level + rand () % 16;
+		if (rand () % 64 == 0)
+		{
+			reading = 900;
+		}
+		samples[sample] = reading;
+	}
+
+	printf ("bench_filters: host time per sample, fastest of %d runs of %ld samples\n",
+			BENCH_RUNS, BENCH_SAMPLES);
+	#ifdef BENCH_HAS_TSC
+		printf ("  filter                     ns   cycles\n");
+	#endif
+	time_filter<median_filter<SENSOR_MEDIAN_LENGTH> > ("median");
+	time_filter<iir_filter<SENSOR_IIR_SHIFT> > ("low pass");
+	time_filter<sensor_filter_t> ("median then low pass");
+	time_filter<sensor_baseline_t> ("baseline");
+	time_filter<sensor_pipeline> ("whole sensor chain");
+	return (0);
+}
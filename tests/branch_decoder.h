@@ -0,0 +1,138 @@
+//======================================================================================
+/** @file branch_decoder.h
+ *    This file contains the encoder decoder which the driver used before the table
+ *    lookup, so the tests and benchmarks can compare the two. It is the body of the
+ *    old interrupt service routine with its shared variables made into parameters: 
+ *    a chain of tests on the whole pin register, one bit at a time.
+ *
+ *  Revisions:
+ *    @li 10-16-2026 Original file, from the 02-09-2015 encoder ISR
+ *
+ *  License:
+ *    This file is copyright 2026 by its authors and released under the Lesser GNU
+ *    Public License, version 2, as the rest of this project is. It is intended for
+ *    educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//======================================================================================
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _BRANCH_DECODER_H_
+#define _BRANCH_DECODER_H_
+
+#include <stdint.h>                         // Standard integer types
+
+//-------------------------------------------------------------------------------------
+/** @brief   Decodes one edge the way the old encoder ISR did.
+ *  @details Unlike the table, a pin register with no change at all in the encoder's
+ *           channels counts as an error here.
+ *  @param   STATE The pin register read in the ISR
+ *  @param   STATE_OLD The pin register read in the ISR before
+ *  @param   EXT_PIN_NUMBER_A The pin number of channel A
+ *  @param   EXT_PIN_NUMBER_B The pin number of channel B
+ *  @param   ENCODER_COUNT The encoder count, which is moved by a legal step
+ *  @param   ERROR_COUNT The error count, which is incremented by an illegal one
+ */
+
+inline void branch_decode (uint8_t STATE, uint8_t STATE_OLD, uint8_t EXT_PIN_NUMBER_A,
+						   uint8_t EXT_PIN_NUMBER_B, uint32_t& ENCODER_COUNT, 
+						   uint32_t& ERROR_COUNT)
+{
+	// For Channel A and Channel B state: 00
+	if (!(STATE & (1 <<EXT_PIN_NUMBER_A)) && !(STATE & (1 <<EXT_PIN_NUMBER_B)))
+	{	
+		// If previous state was 01, increment ENCODER_COUNT in positive direction
+		if (!(STATE_OLD & (1 <<EXT_PIN_NUMBER_A)) && (STATE_OLD & (1 <<EXT_PIN_NUMBER_B)))
+		{
+			ENCODER_COUNT++;
+		}
+		
+		// If previous state was 10, increment ENCODER_COUNT in negative direction
+		else if ((STATE_OLD & (1 <<EXT_PIN_NUMBER_A)) && !(STATE_OLD & (1 <<EXT_PIN_NUMBER_B)))
+		{
+			ENCODER_COUNT--;
+		}
+		
+		// If previous state was neither 01 or 10, increment ERROR_COUNT
+		else
+		{
+			ERROR_COUNT++;
+		}
+	}
+	
+	// 01
+	if (!(STATE & (1 <<EXT_PIN_NUMBER_A)) && (STATE & (1 <<EXT_PIN_NUMBER_B)))
+	{
+		// If previous state was 11, increment ENCODER_COUNT in positive direction
+		if ((STATE_OLD & (1 <<EXT_PIN_NUMBER_A)) && (STATE_OLD & (1 <<EXT_PIN_NUMBER_B)))
+		{
+			ENCODER_COUNT++;
+		}
+		
+		// If previous state was 00, increment ENCODER_COUNT in negative direction
+		else if (!(STATE_OLD & (1 <<EXT_PIN_NUMBER_A)) && !(STATE_OLD & (1 <<EXT_PIN_NUMBER_B)))
+		{
+			ENCODER_COUNT--;
+		}
+		
+		// If previous state was neither 11 or 00, increment ERROR_COUNT
+		else
+		{
+			ERROR_COUNT++;
+		}
+	}
+	
+	// 10
+	if ((STATE & (1 <<EXT_PIN_NUMBER_A)) && !(STATE & (1 <<EXT_PIN_NUMBER_B)))
+	{
+		// If previous state was 00, increment ENCODER_COUNT in positive direction
+		if (!(STATE_OLD & (1 <<EXT_PIN_NUMBER_A)) && !(STATE_OLD & (1 <<EXT_PIN_NUMBER_B)))
+		{
+			ENCODER_COUNT++;
+		}
+		
+		// If previous state was 11, increment ENCODER_COUNT in negative direction
+		else if ((STATE_OLD & (1 <<EXT_PIN_NUMBER_A)) && (STATE_OLD & (1 <<EXT_PIN_NUMBER_B)))
+		{
+			ENCODER_COUNT--;
+		}
+		
+		// If previous state was neither 00 or 11, increment ERROR_COUNT
+		else
+		{
+			ERROR_COUNT++;
+		}
+	}
+	
+	// 11
+	if ((STATE & (1 <<EXT_PIN_NUMBER_A)) && (STATE & (1 <<EXT_PIN_NUMBER_B)))
+	{
+		// If previous state was 10, increment ENCODER_COUNT in positive direction
+		if ((STATE_OLD & (1 <<EXT_PIN_NUMBER_A)) && !(STATE_OLD & (1 <<EXT_PIN_NUMBER_B)))
+		{
+			ENCODER_COUNT++;
+		}
+		
+		// If previous state was 01, increment ENCODER_COUNT in negative direction
+		else if (!(STATE_OLD & (1 <<EXT_PIN_NUMBER_A)) && (STATE_OLD & (1 <<EXT_PIN_NUMBER_B)))
+		{
+			ENCODER_COUNT--;
+		}
+		
+		// If previous state was neither 10 or 01, increment ERROR_COUNT
+		else
+		{
+			ERROR_COUNT++;
+		}
+	}
+}
+
+#endif // _BRANCH_DECODER_H_
@@ -0,0 +1,183 @@
+//======================================================================================
+/** @file host.cpp
+ *    This file contains the register variables, FreeRTOS stand-ins and result 
+ *    counting which the host tests share. Each FreeRTOS queue is an ordinary list of
+ *    fixed size items and each semaphore is a count of how many times it was given.
+ *
+ *  Revisions:
+ *    @li 10-16-2026 Original file
+ *
+ *  License:
+ *    This file is copyright 2026 by its authors and released under the Lesser GNU
+ *    Public License, version 2, as the rest of this project is. It is intended for
+ *    educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//======================================================================================
+
+#include <string.h>
+#include <deque>
+#include <string>
+
+#include <avr/io.h>                         // Stand-in special function registers
+#include "task.h"                           // Stand-in FreeRTOS task functions
+#include "queue.h"                          // Stand-in FreeRTOS queues
+#include "semphr.h"                         // Stand-in FreeRTOS semaphores
+#include "emstream.h"                       // Stand-in serial stream
+
+#include "host.h"                           // Header for this harness
+
+
+// Each register is a plain variable
+#define HOST_DEFINE_8(name)  volatile uint8_t name;
+#define HOST_DEFINE_16(name) volatile uint16_t name;
+HOST_REGISTERS (HOST_DEFINE_8, HOST_DEFINE_16)
+
+TickType_t host_ticks = 0;
+uint16_t host_failures = 0;
+uint32_t host_checks = 0;
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Records the result of one check.
+ *  @param   passed True if the check passed
+ *  @param   file The source file which made the check
+ *  @param   line The line in that file
+ *  @param   what The text of the check
+ *  @return  The same as \p passed
+ */
+
+bool host_check (bool passed, const char* file, int line, const char* what)
+{
+	host_checks++;
+	if (!passed)
+	{
+		host_failures++;
+		printf ("FAIL %s:%d: %s\n", file, line, what);
+	}
+	return (passed);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Prints the result of a test program.
+ *  @param   name The name of the test program
+ *  @return  Zero if every check passed, or one if any failed
+ */
+
+int host_report (const char* name)
+{
+	printf ("%s: %lu checks, %u failed\n", name, (unsigned long)host_checks, 
+			host_failures);
+	return (host_failures ? 1 : 0);
+}
+
+
+//-------------------------------------------------------------------------------------
+// The FreeRTOS functions which the drivers call
+
+TickType_t xTaskGetTickCount (void)
+{
+	return (host_ticks);
+}
+
+TickType_t xTaskGetTickCountFromISR (void)
+{
+	return (host_ticks);
+}
+
+/// A stand-in FreeRTOS queue, which never blocks
+struct host_queue_t
+{
+	size_t length;                          ///< The most items it can hold
+	size_t size;                            ///< The size of each item in bytes
+	std::deque<std::string> items;          ///< The items waiting, oldest first
+};
+
+QueueHandle_t xQueueCreate (UBaseType_t length, UBaseType_t size)
+{
+	host_queue_t* p_queue = new host_queue_t;
+
+	p_queue->length = length;
+	p_queue->size = size;
+	return (p_queue);
+}
+
+BaseType_t xQueueSendToBack (QueueHandle_t queue, const void* item, TickType_t)
+{
+	host_queue_t* p_queue = (host_queue_t*)queue;
+
+	if (p_queue->items.size () >= p_queue->length)
+	{
+		return (pdFALSE);
+	}
+	p_queue->items.push_back (std::string ((const char*)item, p_queue->size));
+	return (pdTRUE);
+}
+
+BaseType_t xQueueReceive (QueueHandle_t queue, void* item, TickType_t)
+{
+	host_queue_t* p_queue = (host_queue_t*)queue;
+
+	if (p_queue->items.empty ())
+	{
+		return (pdFALSE);
+	}
+	memcpy (item, p_queue->items.front ().data (), p_queue->size);
+	p_queue->items.pop_front ();
+	return (pdTRUE);
+}
+
+BaseType_t xQueueReceiveFromISR (QueueHandle_t queue, void* item, BaseType_t*)
+{
+	return (xQueueReceive (queue, item, 0));
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary (void)
+{
+	return (new uint16_t (0));
+}
+
+BaseType_t xSemaphoreGiveFromISR (SemaphoreHandle_t semaphore, BaseType_t*)
+{
+	(*(uint16_t*)semaphore)++;
+	return (pdTRUE);
+}
+
+
+//-------------------------------------------------------------------------------------
+// The stand-in serial stream prints everything in decimal into its string
+
+emstream& emstream::operator << (const char* string) { text += string; return (*this); }
+emstream& emstream::operator << (char character) { text += character; return (*this); }
+emstream& emstream::operator << (bool value) { text += value ? "1" : "0"; return (*this); }
+emstream& emstream::operator << (int8_t value) { return (*this << (long)value); }
+emstream& emstream::operator << (uint8_t value) { return (*this << (unsigned long)value); }
+emstream& emstream::operator << (int16_t value) { return (*this << (long)value); }
+emstream& emstream::operator << (uint16_t value) { return (*this << (unsigned long)value); }
+emstream& emstream::operator << (int32_t value) { return (*this << (long)value); }
+emstream& emstream::operator << (uint32_t value) { return (*this << (unsigned long)value); }
+emstream& emstream::operator << (long value) { text += std::to_string (value); return (*this); }
+emstream& emstream::operator << (unsigned long value)
+{
+	text += std::to_string (value);
+	return (*this);
+}
+emstream& emstream::operator << (float value) { return (*this << (double)value); }
+emstream& emstream::operator << (double value) { text += std::to_string (value); return (*this); }
+emstream& emstream::operator << (ser_manipulator manipulator)
+{
+	if (manipulator == endl)
+	{
+		text += '\n';
+	}
+	return (*this);
+}
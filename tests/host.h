@@ -0,0 +1,82 @@
+//======================================================================================
+/** @file host.h
+ *    This file contains the header for the small harness which the host tests share.
+ *    The tests are built with the host's own C++ compiler against the stand-in AVR 
+ *    and FreeRTOS headers in \c stubs/, so the drivers' interrupt service routines 
+ *    can be run one call at a time against registers the test controls.
+ *
+ *  Revisions:
+ *    @li 10-16-2026 Original file
+ *
+ *  License:
+ *    This file is copyright 2026 by its authors and released under the Lesser GNU
+ *    Public License, version 2, as the rest of this project is. It is intended for
+ *    educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//======================================================================================
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _HOST_H_
+#define _HOST_H_
+
+#include <stdint.h>                         // Standard integer types
+#include <stdio.h>                          // For printing failures and results
+
+#include "FreeRTOS.h"                       // Stand-in FreeRTOS types
+
+/// The RTOS tick count which \c xTaskGetTickCount() and its ISR version return
+extern TickType_t host_ticks;
+
+/// The number of checks which have failed so far
+extern uint16_t host_failures;
+
+/// The number of checks which have been made so far
+extern uint32_t host_checks;
+
+// This function records the result of one check, printing it if it failed
+bool host_check (bool passed, const char* file, int line, const char* what);
+
+// This function prints a test program's result; its return is the exit status
+int host_report (const char* name);
+
+/** This macro checks that a condition is true, printing where it isn't. */
+#define CHECK(condition) \
+	host_check ((condition), __FILE__, __LINE__, #condition)
+
+/** This macro checks that two integers are equal, printing both of them if they 
+ *  aren't. */
+#define CHECK_EQUAL(actual, expected) \
+	do { \
+		long long host_actual = (long long)(actual); \
+		long long host_expected = (long long)(expected); \
+		if (!host_check (host_actual == host_expected, __FILE__, __LINE__, \
+						 #actual " == " #expected)) \
+		{ \
+			printf ("    got %lld, expected %lld\n", host_actual, host_expected); \
+		} \
+	} while (0)
+
+/** This macro checks that two numbers are within a tolerance of each other. */
+#define CHECK_NEAR(actual, expected, tolerance) \
+	do { \
+		double host_actual = (double)(actual); \
+		double host_expected = (double)(expected); \
+		double host_error = host_actual - host_expected; \
+		if (!host_check (host_error <= (tolerance) && -host_error <= (tolerance), \
+						 __FILE__, __LINE__, #actual " ~= " #expected)) \
+		{ \
+			printf ("    got %g, expected %g +/- %g\n", host_actual, host_expected, \
+					(double)(tolerance)); \
+		} \
+	} while (0)
+
+#endif // _HOST_H_
@@ -0,0 +1,30 @@
+//======================================================================================
+/** @file FreeRTOS.h
+ *    This host stand-in gives the FreeRTOS types and constants the sources under test
+ *    use, with the same sizes as in the AVR port.
+ */
+//======================================================================================
+
+#ifndef _HOST_FREERTOS_H_
+#define _HOST_FREERTOS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define portBASE_TYPE  char
+typedef signed char    BaseType_t;
+typedef unsigned char  UBaseType_t;
+typedef uint32_t       TickType_t;
+
+#define configTICK_RATE_HZ  ((TickType_t)1000)
+#define portTICK_PERIOD_MS  ((TickType_t)1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY       ((TickType_t)0xFFFFFFFF)
+#define pdTRUE   1
+#define pdFALSE  0
+#define pdPASS   1
+
+#define portENTER_CRITICAL()
+#define portEXIT_CRITICAL()
+#define portYIELD_FROM_ISR(woken)
+
+#endif // _HOST_FREERTOS_H_
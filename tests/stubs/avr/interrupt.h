@@ -0,0 +1,18 @@
+//======================================================================================
+/** @file avr/interrupt.h
+ *    This host stand-in turns each interrupt service routine into an ordinary function
+ *    named after its vector, which a test calls wherever the interrupt would happen.
+ *    Interrupts never really happen on the host, so turning them off does nothing.
+ */
+//======================================================================================
+
+#ifndef _HOST_AVR_INTERRUPT_H_
+#define _HOST_AVR_INTERRUPT_H_
+
+#define ISR(vector, ...)  extern "C" void vector (void); void vector (void)
+#define ISR_ALIAS(vector, target)  extern "C" void vector (void)
+#define ISR_NOBLOCK
+#define cli()
+#define sei()
+
+#endif // _HOST_AVR_INTERRUPT_H_
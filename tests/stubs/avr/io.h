@@ -0,0 +1,53 @@
+//======================================================================================
+/** @file avr/io.h
+ *    This host stand-in for avr-libc's register header declares each special function
+ *    register the sources under test use as a plain variable, so a test can set the
+ *    pins and converter results an interrupt service routine reads and look at the
+ *    registers it writes. The variables are defined in @c host.cpp. Only registers 
+ *    which the ATmega1281 really has are given, so code which uses one it lacks, 
+ *    such as those of timers 4 and 5, won't build here either.
+ */
+//======================================================================================
+
+#ifndef _HOST_AVR_IO_H_
+#define _HOST_AVR_IO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/// The 8-bit and 16-bit registers, listed once for both declaring and defining them
+#define HOST_REGISTERS(R8, R16) \
+	R8 (PINA) R8 (PINB) R8 (PINC) R8 (PIND) R8 (PINE) R8 (PINF) \
+	R8 (PORTA) R8 (PORTB) R8 (PORTC) R8 (PORTD) R8 (PORTE) R8 (PORTF) \
+	R8 (DDRA) R8 (DDRB) R8 (DDRC) R8 (DDRD) R8 (DDRE) R8 (DDRF) \
+	R8 (EIMSK) R8 (EICRA) R8 (EICRB) R8 (EIFR) R8 (MCUSR) R8 (SREG) \
+	R8 (ADCSRA) R8 (ADCSRB) R8 (ADMUX) R8 (ADCL) R8 (ADCH) R16 (ADC) R8 (DIDR0) \
+	R8 (TCCR0A) R8 (TCCR0B) R8 (TCNT0) R8 (OCR0A) R8 (OCR0B) R8 (TIMSK0) R8 (TIFR0) \
+	R8 (TCCR1A) R8 (TCCR1B) R8 (TCCR1C) R16 (TCNT1) R16 (OCR1A) R16 (OCR1B) \
+	R16 (OCR1C) R16 (ICR1) R8 (TIMSK1) \
+	R8 (TCCR2A) R8 (TCCR2B) R8 (TCNT2) R8 (OCR2A) R8 (OCR2B) R8 (TIMSK2) R8 (TIFR2) \
+	R8 (TCCR3A) R8 (TCCR3B) R8 (TCCR3C) R16 (TCNT3) R16 (OCR3A) R16 (OCR3B) \
+	R16 (ICR3) R8 (TIMSK3) R8 (TIFR3)
+
+#define HOST_EXTERN_8(name)  extern volatile uint8_t name;
+#define HOST_EXTERN_16(name) extern volatile uint16_t name;
+HOST_REGISTERS (HOST_EXTERN_8, HOST_EXTERN_16)
+
+enum { PE0, PE1, PE2, PE3, PE4, PE5, PE6, PE7 };
+enum { ISC40 = 0, ISC41, ISC50, ISC51, ISC60, ISC61, ISC70, ISC71 };
+enum { INT4 = 4, INT5, INT6, INT7 };
+enum { INTF4 = 4, INTF5, INTF6, INTF7 };
+enum { ADPS0 = 0, ADPS1, ADPS2, ADIE, ADIF, ADATE, ADSC, ADEN };
+enum { MUX0 = 0, MUX1, MUX2, MUX3, MUX4, ADLAR, REFS0, REFS1 };
+enum { ADTS0 = 0, ADTS1, ADTS2, MUX5, ACME = 6 };
+enum { WGM00 = 0, WGM01, COM0A0 = 6, COM0A1 };
+enum { CS00 = 0, CS01, CS02, WGM02 };
+enum { TOV0 = 0, OCIE0A, OCF0A = 1 };
+enum { WGM10 = 0, WGM11, COM1C0, COM1C1, COM1B0, COM1B1, COM1A0, COM1A1 };
+enum { CS10 = 0, CS11, CS12, WGM12, WGM13 };
+enum { WGM20 = 0, WGM21, CS20 = 0, CS21, CS22, WGM22 };
+enum { OCIE2A = 1, OCF2A = 1 };
+enum { WGM30 = 0, WGM31, COM3B0 = 4, COM3B1 };
+enum { CS30 = 0, CS31, CS32, WGM32, WGM33, TOV3 = 0, OCF3A };
+
+#endif // _HOST_AVR_IO_H_
@@ -0,0 +1,16 @@
+//======================================================================================
+/** @file avr/pgmspace.h
+ *    This host stand-in keeps program memory data in ordinary memory.
+ */
+//======================================================================================
+
+#ifndef _HOST_AVR_PGMSPACE_H_
+#define _HOST_AVR_PGMSPACE_H_
+
+#include <stdint.h>
+
+#define PROGMEM
+#define pgm_read_byte(address)  (*(const uint8_t*)(address))
+#define pgm_read_word(address)  (*(const uint16_t*)(address))
+
+#endif // _HOST_AVR_PGMSPACE_H_
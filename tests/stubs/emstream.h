@@ -0,0 +1,43 @@
+//======================================================================================
+/** @file emstream.h
+ *    This host stand-in for the ME405 library's stream class keeps everything printed
+ *    to it in a string, so a test can check what a driver prints.
+ */
+//======================================================================================
+
+#ifndef _HOST_EMSTREAM_H_
+#define _HOST_EMSTREAM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+/// The stream manipulators the sources under test use
+enum ser_manipulator { endl, dec, bin, hex, clrscr };
+
+/// A stream which adds whatever is printed to it to @c text, always in decimal
+class emstream
+{
+	public:
+		std::string text;                   ///< Everything printed so far
+
+		emstream& operator << (const char* string);
+		emstream& operator << (char character);
+		emstream& operator << (bool value);
+		emstream& operator << (int8_t value);
+		emstream& operator << (uint8_t value);
+		emstream& operator << (int16_t value);
+		emstream& operator << (uint16_t value);
+		emstream& operator << (int32_t value);
+		emstream& operator << (uint32_t value);
+		emstream& operator << (long value);
+		emstream& operator << (unsigned long value);
+		emstream& operator << (float value);
+		emstream& operator << (double value);
+		emstream& operator << (ser_manipulator manipulator);
+};
+
+#define PMS(string)  string
+#define DBG(p_serial, stuff)  do { if (p_serial) { *(p_serial) << stuff; } } while (0)
+
+#endif // _HOST_EMSTREAM_H_
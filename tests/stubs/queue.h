@@ -0,0 +1,20 @@
+//======================================================================================
+/** @file queue.h
+ *    This host stand-in declares the FreeRTOS queue functions the sources under test
+ *    call; the queues are ordinary first in, first out lists.
+ */
+//======================================================================================
+
+#ifndef _HOST_QUEUE_H_
+#define _HOST_QUEUE_H_
+
+#include "FreeRTOS.h"
+
+typedef void* QueueHandle_t;
+
+QueueHandle_t xQueueCreate (UBaseType_t length, UBaseType_t size);
+BaseType_t xQueueSendToBack (QueueHandle_t queue, const void* item, TickType_t wait);
+BaseType_t xQueueReceive (QueueHandle_t queue, void* item, TickType_t wait);
+BaseType_t xQueueReceiveFromISR (QueueHandle_t queue, void* item, BaseType_t* woken);
+
+#endif // _HOST_QUEUE_H_
@@ -0,0 +1,12 @@
+//======================================================================================
+/** @file rs232int.h
+ *    This host stand-in has no serial port; the sources under test only include it.
+ */
+//======================================================================================
+
+#ifndef _HOST_RS232INT_H_
+#define _HOST_RS232INT_H_
+
+#include "emstream.h"
+
+#endif // _HOST_RS232INT_H_
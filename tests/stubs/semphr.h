@@ -0,0 +1,18 @@
+//======================================================================================
+/** @file semphr.h
+ *    This host stand-in declares the FreeRTOS semaphore functions the sources under
+ *    test call.
+ */
+//======================================================================================
+
+#ifndef _HOST_SEMPHR_H_
+#define _HOST_SEMPHR_H_
+
+#include "queue.h"
+
+typedef void* SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateBinary (void);
+BaseType_t xSemaphoreGiveFromISR (SemaphoreHandle_t semaphore, BaseType_t* woken);
+
+#endif // _HOST_SEMPHR_H_
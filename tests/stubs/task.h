@@ -0,0 +1,22 @@
+//======================================================================================
+/** @file task.h
+ *    This host stand-in declares the FreeRTOS task functions the sources under test
+ *    call. The tick count is whatever a test puts in @c host_ticks.
+ */
+//======================================================================================
+
+#ifndef _HOST_TASK_H_
+#define _HOST_TASK_H_
+
+#include "FreeRTOS.h"
+
+typedef void* TaskHandle_t;
+
+TickType_t xTaskGetTickCount (void);
+TickType_t xTaskGetTickCountFromISR (void);
+
+#define taskENTER_CRITICAL()  portENTER_CRITICAL()
+#define taskEXIT_CRITICAL()   portEXIT_CRITICAL()
+#define taskYIELD()
+
+#endif // _HOST_TASK_H_
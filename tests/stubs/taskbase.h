@@ -0,0 +1,21 @@
+//======================================================================================
+/** @file taskbase.h
+ *    This host stand-in declares the base task class which the task headers derive
+ *    from; the benchmarks only use the types those headers define, never a task.
+ */
+//======================================================================================
+
+#ifndef _HOST_TASKBASE_H_
+#define _HOST_TASKBASE_H_
+
+#include <stddef.h>
+
+class emstream;
+
+class TaskBase
+{
+	public:
+		TaskBase (const char*, unsigned, size_t, emstream*) { }
+};
+
+#endif // _HOST_TASKBASE_H_
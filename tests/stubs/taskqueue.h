@@ -0,0 +1,13 @@
+//======================================================================================
+/** @file taskqueue.h
+ *    This host stand-in declares the queue class which the task headers name; the 
+ *    sources under test never use one.
+ */
+//======================================================================================
+
+#ifndef _HOST_TASKQUEUE_H_
+#define _HOST_TASKQUEUE_H_
+
+template <class T> class TaskQueue;
+
+#endif // _HOST_TASKQUEUE_H_
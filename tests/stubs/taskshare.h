@@ -0,0 +1,13 @@
+//======================================================================================
+/** @file taskshare.h
+ *    This host stand-in declares the shared data class which @c shares.h names; the
+ *    sources under test never use one.
+ */
+//======================================================================================
+
+#ifndef _HOST_TASKSHARE_H_
+#define _HOST_TASKSHARE_H_
+
+template <class T> class TaskShare;
+
+#endif // _HOST_TASKSHARE_H_
@@ -0,0 +1,13 @@
+//======================================================================================
+/** @file textqueue.h
+ *    This host stand-in declares the text queue class which @c shares.h names; the
+ *    sources under test never use one.
+ */
+//======================================================================================
+
+#ifndef _HOST_TEXTQUEUE_H_
+#define _HOST_TEXTQUEUE_H_
+
+class TextQueue;
+
+#endif // _HOST_TEXTQUEUE_H_
@@ -0,0 +1,13 @@
+//======================================================================================
+/** @file time_stamp.h
+ *    This host stand-in declares the time stamp class which the task headers name;
+ *    the sources under test never use one.
+ */
+//======================================================================================
+
+#ifndef _HOST_TIME_STAMP_H_
+#define _HOST_TIME_STAMP_H_
+
+class time_stamp;
+
+#endif // _HOST_TIME_STAMP_H_
@@ -0,0 +1,15 @@
+//======================================================================================
+/** @file util/atomic.h
+ *    This host stand-in runs an atomic block's body once. Nothing interrupts it on the
+ *    host, so it is atomic anyway.
+ */
+//======================================================================================
+
+#ifndef _HOST_UTIL_ATOMIC_H_
+#define _HOST_UTIL_ATOMIC_H_
+
+#define ATOMIC_RESTORESTATE  0
+#define ATOMIC_FORCEON       1
+#define ATOMIC_BLOCK(type)   for (uint8_t host_atomic = 1; host_atomic; host_atomic = 0)
+
+#endif // _HOST_UTIL_ATOMIC_H_
@@ -0,0 +1,261 @@
+//======================================================================================
+/** @file test_adc_autorange.cpp
+ *    This file contains host tests of the A/D driver's auto-ranging, which is built 
+ *    with \c -DADC_AUTORANGE. The model converts voltages against whichever reference
+ *    \c ADMUX selects, and the tests check when the scan switches references, the 
+ *    band between @c ADC_RANGE_UP and @c ADC_RANGE_DOWN in which it doesn't, that 
+ *    exactly @c ADC_RANGE_SETTLE conversions are thrown away after each switch, and
+ *    that readings on either reference come out on the same 0 to 4092 scale.
+ *
+ *  Revisions:
+ *    @li 10-16-2026 Original file
+ *
+ *  License:
+ *    This file is copyright 2026 by its authors and released under the Lesser GNU
+ *    Public License, version 2, as the rest of this project is. It is intended for
+ *    educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//======================================================================================
+
+#include <stdlib.h>
+
+#include "adc.h"                            // The A/D driver under test
+#include "adc_model.h"                      // A model of the converter
+#include "host.h"                           // Checks and stand-in registers
+
+#ifndef ADC_AUTORANGE
+	#error "This test must be built with -DADC_AUTORANGE"
+#endif
+
+/// The channels scanned
+static const uint8_t CHANNELS[] = { 0, 1 };
+
+/// The number of channels in the list
+#define CHANNEL_COUNT  (sizeof (CHANNELS) / sizeof (CHANNELS[0]))
+
+/// The conversions of each channel in a pass
+#define SAMPLES  4
+
+/// The full scale reading on the common scale
+#define FULL_SCALE  (1023 << ADC_RANGE_BITS)
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Returns true if the internal reference is selected.
+ */
+
+static bool on_internal (void)
+{
+	return ((ADMUX & ((1 << REFS1) | (1 << REFS0))) == ((1 << REFS1) | (1 << REFS0)));
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Converts a voltage against the selected reference, clipping at full scale.
+ *  @param   millivolts The voltage on the channel
+ *  @return  The A/D result, from 0 to 1023
+ */
+
+static uint16_t counts (uint16_t millivolts)
+{
+	uint32_t reference = on_internal () ? ADC_INTERNAL_MV : ADC_AVCC_MV;
+	uint32_t result = (uint32_t)millivolts * 1024 / reference;
+
+	return ((result > 1023) ? 1023 : result);
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Runs one pass of the scan with the given voltages on the channels.
+ *  @param   millivolts The voltage on each channel in the list
+ *  @param   expected An array which gets each reading on the common scale, worked out
+ *           from the conversions here
+ */
+
+static void play_pass (const uint16_t* millivolts, uint16_t* expected)
+{
+	uint32_t sums[CHANNEL_COUNT] = { 0 };
+	bool internal = on_internal ();
+
+	for (uint8_t conversion = 0; conversion < SAMPLES * CHANNEL_COUNT; conversion++)
+	{
+		uint8_t index = conversion % CHANNEL_COUNT;
+		uint16_t reading = counts (millivolts[index]);
+
+		CHECK_EQUAL (adc_channel (), CHANNELS[index]);
+		sums[index] += reading;
+		adc_convert (reading);
+	}
+	for (uint8_t index = 0; index < CHANNEL_COUNT; index++)
+	{
+		expected[index] = internal 
+			? sums[index] * ((uint32_t)ADC_INTERNAL_MV << ADC_RANGE_BITS) 
+			  / ((uint32_t)ADC_AVCC_MV * SAMPLES)
+			: (sums[index] << ADC_RANGE_BITS) / SAMPLES;
+	}
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Runs a pass and checks its readings and the reference used next.
+ *  @param   a2d The A/D driver
+ *  @param   millivolts The voltage on each channel in the list
+ *  @param   internal_next Whether the internal reference should be selected after it
+ */
+
+static void check_pass (adc& a2d, const uint16_t* millivolts, bool internal_next)
+{
+	uint16_t expected[CHANNEL_COUNT];
+	uint16_t readings[CHANNEL_COUNT];
+	uint16_t passes = a2d.get_scan (readings);
+	bool internal = on_internal ();
+
+	play_pass (millivolts, expected);
+	CHECK_EQUAL (a2d.get_scan (readings), passes + 1);
+	CHECK_EQUAL (on_internal (), internal_next);
+	for (uint8_t index = 0; index < CHANNEL_COUNT; index++)
+	{
+		// Both references put a voltage at the same place on the common scale, to 
+		// within one count of whichever made the reading
+		uint32_t ideal = (uint32_t)millivolts[index] * (FULL_SCALE + 4) / ADC_AVCC_MV;
+		CHECK_EQUAL (readings[index], expected[index]);
+		if (ideal < FULL_SCALE)
+		{
+			CHECK_NEAR (readings[index], ideal, internal ? 3 : 4);
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Throws conversions at the scan while its reference settles and checks 
+ *           that exactly @c ADC_RANGE_SETTLE of them are thrown away.
+ *  @details The conversions are full scale, so one which got into the sums would 
+ *           spoil the next pass, and the first channel is converted all the while.
+ *           Since the pass after settling is checked to end on time, one more 
+ *           conversion thrown away would be caught as well.
+ */
+
+static void settle (adc& a2d)
+{
+	uint16_t readings[CHANNEL_COUNT];
+	uint16_t passes = a2d.get_scan (readings);
+
+	for (uint16_t conversion = 0; conversion < ADC_RANGE_SETTLE; conversion++)
+	{
+		CHECK_EQUAL (adc_channel (), CHANNELS[0]);
+		adc_convert (1023);
+	}
+	CHECK_EQUAL (a2d.get_scan (readings), passes);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks the common scale: 0 to 4092 on AVCC, with a reading on the internal
+ *           reference landing where the same voltage reads on AVCC.
+ */
+
+static void test_scale (adc& a2d)
+{
+	static const uint16_t FULL[CHANNEL_COUNT] = { 5000, 4000 };
+	static const uint16_t SMALL[CHANNEL_COUNT] = { 1000, 400 };
+	uint16_t readings[CHANNEL_COUNT];
+
+	ADMUX = (1 << REFS0);
+	a2d.start_scan (CHANNELS, CHANNEL_COUNT, SAMPLES);
+	check_pass (a2d, FULL, false);
+	a2d.get_scan (readings);
+	CHECK_EQUAL (readings[0], FULL_SCALE);
+	CHECK_EQUAL (FULL_SCALE, 4092);
+
+	check_pass (a2d, SMALL, true);
+	settle (a2d);
+	check_pass (a2d, SMALL, true);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks where the scan switches up and down, and that it doesn't switch in
+ *           the band between.
+ *  @details On AVCC the scan switches to the internal reference when the largest
+ *           conversion of a pass is under @c ADC_RANGE_UP, about 2.19 V; on the 
+ *           internal reference it switches back when one reaches @c ADC_RANGE_DOWN, 
+ *           about 2.5 V. The largest conversion of all the channels counts, so one 
+ *           big signal keeps the small ones on AVCC.
+ */
+
+static void test_hysteresis (adc& a2d)
+{
+	const uint16_t UP_MV = (uint32_t)ADC_RANGE_UP * ADC_AVCC_MV / 1024;
+	const uint16_t DOWN_MV = (uint32_t)ADC_RANGE_DOWN * ADC_INTERNAL_MV / 1024;
+	uint16_t band[CHANNEL_COUNT] = { (uint16_t)((UP_MV + DOWN_MV) / 2), 100 };
+	uint16_t band_bottom[CHANNEL_COUNT] = { (uint16_t)(UP_MV + 3), 100 };
+	uint16_t band_top[CHANNEL_COUNT] = { 100, (uint16_t)(DOWN_MV - 3) };
+	uint16_t low[CHANNEL_COUNT] = { (uint16_t)(UP_MV - 5), 100 };
+	uint16_t high[CHANNEL_COUNT] = { 50, (uint16_t)(DOWN_MV + 3) };
+
+	ADMUX = (1 << REFS0);
+	a2d.start_scan (CHANNELS, CHANNEL_COUNT, SAMPLES);
+
+	// In the band, AVCC is kept however many passes go by, right down to its bottom
+	for (uint8_t pass = 0; pass < 5; pass++)
+	{
+		check_pass (a2d, band, false);
+	}
+	check_pass (a2d, band_bottom, false);
+
+	// Just below the band it goes up, and stays there when the signal goes back up
+	// into the band
+	check_pass (a2d, low, true);
+	settle (a2d);
+	for (uint8_t pass = 0; pass < 5; pass++)
+	{
+		check_pass (a2d, band, true);
+	}
+	check_pass (a2d, band_top, true);
+
+	// Just above the band on either channel it comes down, and stays down in the band
+	check_pass (a2d, high, false);
+	settle (a2d);
+	for (uint8_t pass = 0; pass < 5; pass++)
+	{
+		check_pass (a2d, band, false);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks that a scan started on the internal reference stays on it.
+ */
+
+static void test_start_on_internal (adc& a2d)
+{
+	static const uint16_t SMALL[CHANNEL_COUNT] = { 1500, 700 };
+
+	ADMUX = (1 << REFS1) | (1 << REFS0);
+	a2d.start_scan (CHANNELS, CHANNEL_COUNT, SAMPLES);
+	CHECK (on_internal ());
+	check_pass (a2d, SMALL, true);
+	check_pass (a2d, SMALL, true);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Runs the auto-ranging tests.
+ */
+
+int main (void)
+{
+	adc a2d;
+
+	test_scale (a2d);
+	test_hysteresis (a2d);
+	test_start_on_internal (a2d);
+
+	return (host_report ("test_adc_autorange"));
+}
@@ -0,0 +1,222 @@
+//======================================================================================
+/** @file test_adc_lockin.cpp
+ *    This file contains host tests of the A/D driver's lock-in demodulation, which is
+ *    built with \c -DADC_LOCKIN. Each channel sees a steady ambient level plus a beacon
+ *    flashing at @c ADC_TRIGGER_HZ / (4 * count), sampled four times per flash; the 
+ *    amplitudes @c get_scan() gives are checked against the beacon's amplitude and 
+ *    against 2 sqrt(I^2 + Q^2) / samples worked out from the conversions here. The 
+ *    in-phase and quadrature sums are kept unsigned, so phases which make them 
+ *    negative are tested too, as is the rounding of each pass down to whole flashes.
+ *
+ *  Revisions:
+ *    @li 10-16-2026 Original file
+ *
+ *  License:
+ *    This file is copyright 2026 by its authors and released under the Lesser GNU
+ *    Public License, version 2, as the rest of this project is. It is intended for
+ *    educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//======================================================================================
+
+#include <stdlib.h>
+#include <math.h>
+
+#include "adc.h"                            // The A/D driver under test
+#include "task_sensor.h"                    // The sensor task's scan settings
+#include "square_root.h"                    // Integer square root
+#include "adc_model.h"                      // A model of the converter
+#include "host.h"                           // Checks and stand-in registers
+
+#ifndef ADC_LOCKIN
+	#error "This test must be built with -DADC_LOCKIN"
+#endif
+
+/// The most channels the tests scan
+#define LOCKIN_CHANNELS  4
+
+//-------------------------------------------------------------------------------------
+/** @brief   This structure describes the light one channel sees.
+ */
+
+struct lockin_light_t
+{
+	uint16_t ambient;                       ///< The steady level in A/D counts
+	uint16_t amplitude;                     ///< The beacon's amplitude in A/D counts
+	double   phase;                         ///< The beacon's phase in radians
+};
+
+//-------------------------------------------------------------------------------------
+/** @brief   Runs one pass of a scan, converting the light each channel sees, and
+ *           works out the amplitudes the driver should give from those conversions.
+ *  @param   lights The light which each channel in the scan sees
+ *  @param   count The number of channels in the scan
+ *  @param   samples The conversions of each channel in a pass, as the driver uses it
+ *  @param   expected An array which gets 2 sqrt(I^2 + Q^2) / samples for each channel
+ */
+
+static void play_pass (const lockin_light_t* lights, uint8_t count, uint8_t samples,
+					   uint16_t* expected)
+{
+	int32_t in_phase[LOCKIN_CHANNELS] = { 0 };
+	int32_t in_quad[LOCKIN_CHANNELS] = { 0 };
+
+	for (uint8_t taken = 0; taken < samples; taken++)
+	{
+		for (uint8_t index = 0; index < count; index++)
+		{
+			const lockin_light_t& light = lights[index];
+			uint16_t reading = (uint16_t)lround (light.ambient + light.amplitude 
+				* cos (M_PI / 2 * taken + light.phase));
+
+			CHECK_EQUAL (adc_channel (), index);
+			switch (taken & 0x03)
+			{
+				case (0): in_phase[index] += reading; break;
+				case (1): in_quad[index] += reading;  break;
+				case (2): in_phase[index] -= reading; break;
+				default:  in_quad[index] -= reading;  break;
+			}
+			adc_convert (reading);
+		}
+	}
+	for (uint8_t index = 0; index < count; index++)
+	{
+		expected[index] = 2 * (uint32_t)square_root (in_phase[index] * in_phase[index]
+			+ in_quad[index] * in_quad[index]) / samples;
+	}
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Starts a scan of the first channels and runs one pass of it, checking 
+ *           the amplitudes it gives.
+ *  @param   a2d The A/D driver
+ *  @param   lights The light which each channel sees
+ *  @param   count The number of channels in the scan
+ *  @param   samples The number of conversions asked for
+ *  @param   used The number of conversions the driver should use
+ *  @param   tolerance How far each amplitude may be from the beacon's
+ */
+
+static void check_pass (adc& a2d, const lockin_light_t* lights, uint8_t count, 
+						uint8_t samples, uint8_t used, uint16_t tolerance)
+{
+	static const uint8_t CHANNELS[LOCKIN_CHANNELS] = { 0, 1, 2, 3 };
+	uint16_t expected[LOCKIN_CHANNELS];
+	uint16_t readings[LOCKIN_CHANNELS];
+
+	a2d.start_scan (CHANNELS, count, samples);
+
+	// The pass must end after exactly the number of conversions the driver uses
+	play_pass (lights, count, used - 1, expected);
+	CHECK_EQUAL (a2d.get_scan (readings), 0);
+	a2d.start_scan (CHANNELS, count, samples);
+	play_pass (lights, count, used, expected);
+	CHECK_EQUAL (a2d.get_scan (readings), 1);
+
+	for (uint8_t index = 0; index < count; index++)
+	{
+		CHECK_EQUAL (readings[index], expected[index]);
+		CHECK_NEAR (readings[index], lights[index].amplitude, tolerance);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks that the beacon's amplitude is found whatever its phase, and that
+ *           steady light doesn't show up at all.
+ *  @details The phases put the in-phase and quadrature sums in every quadrant, so
+ *           both are negative for some channels, which only works if the unsigned
+ *           sums are read as signed.
+ */
+
+static void test_amplitude_and_phase (adc& a2d)
+{
+	for (uint8_t step = 0; step < 16; step++)
+	{
+		double phase = step * M_PI / 8 + 0.1;
+		lockin_light_t lights[LOCKIN_CHANNELS] = 
+		{
+			{ 400, 200, phase },
+			{ 800, 0, phase },
+			{ 100, 60, phase + M_PI / 2 },
+			{ 512, 500, -phase }
+		};
+
+		check_pass (a2d, lights, LOCKIN_CHANNELS, 8, 8, 2);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks the sums whose signs are most easily mixed up: a beacon exactly
+ *           out of phase, whose in-phase sum is negative and quadrature sum zero, and
+ *           one a quarter cycle later whose quadrature sum is negative.
+ */
+
+static void test_negative_sums (adc& a2d)
+{
+	lockin_light_t lights[2] = 
+	{
+		{ 500, 100, M_PI },
+		{ 500, 100, M_PI / 2 }
+	};
+
+	check_pass (a2d, lights, 2, 8, 8, 0);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks that passes are rounded down to whole flashes of the beacon.
+ *  @details The sensor task asks for @c SENSOR_SAMPLES, 10 at the default rates, which
+ *           the driver uses as 8. Fewer than 4 are raised to 4 and more than 
+ *           @c ADC_LOCKIN_SAMPLES are cut to it; a full scale beacon over that many
+ *           still fits the 16-bit sums.
+ */
+
+static void test_whole_flashes (adc& a2d)
+{
+	lockin_light_t sensors[SENSOR_COUNT > LOCKIN_CHANNELS ? LOCKIN_CHANNELS 
+														  : SENSOR_COUNT];
+	uint8_t count = sizeof (sensors) / sizeof (sensors[0]);
+
+	for (uint8_t index = 0; index < count; index++)
+	{
+		sensors[index].ambient = 300;
+		sensors[index].amplitude = 40 * (index + 1);
+		sensors[index].phase = index;
+	}
+	CHECK_EQUAL (SENSOR_SAMPLES, 10);
+	check_pass (a2d, sensors, count, SENSOR_SAMPLES, SENSOR_SAMPLES & ~0x03, 2);
+	check_pass (a2d, sensors, count, 6, 4, 2);
+	check_pass (a2d, sensors, count, 2, 4, 2);
+	check_pass (a2d, sensors, count, 0, 4, 2);
+
+	lockin_light_t full[1] = { { 512, 511, 0.3 } };
+	check_pass (a2d, full, 1, 200, ADC_LOCKIN_SAMPLES, 2);
+	check_pass (a2d, full, 1, ADC_LOCKIN_SAMPLES + 3, ADC_LOCKIN_SAMPLES, 2);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Runs the lock-in tests.
+ */
+
+int main (void)
+{
+	adc a2d;
+
+	test_amplitude_and_phase (a2d);
+	test_negative_sums (a2d);
+	test_whole_flashes (a2d);
+
+	return (host_report ("test_adc_lockin"));
+}
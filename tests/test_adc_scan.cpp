@@ -0,0 +1,224 @@
+//======================================================================================
+/** @file test_adc_scan.cpp
+ *    This file contains host tests of the A/D driver's scan. Conversions are made by
+ *    the model in \c adc_model.h, which runs the driver's own ISR, and the tests check
+ *    the order in which the channels are selected in \c ADMUX, that the reference 
+ *    bits are kept while they're switched, how the conversions are added up into the
+ *    readings, and that a request is converted between the scan's conversions.
+ *
+ *  Revisions:
+ *    @li 10-16-2026 Original file
+ *
+ *  License:
+ *    This file is copyright 2026 by its authors and released under the Lesser GNU
+ *    Public License, version 2, as the rest of this project is. It is intended for
+ *    educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//======================================================================================
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "adc.h"                            // The A/D driver under test
+#include "adc_model.h"                      // A model of the converter
+#include "host.h"                           // Checks and stand-in registers
+
+/// The list of channels scanned, which isn't in numerical order
+static const uint8_t CHANNELS[] = { 3, 0, 5, 1 };
+
+/// The number of channels in the list
+#define CHANNEL_COUNT  (sizeof (CHANNELS) / sizeof (CHANNELS[0]))
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Makes up the result of a conversion which differs for every channel, pass
+ *           and time through the list, so a conversion added to the wrong sum shows.
+ *  @param   channel The channel converted
+ *  @param   pass The number of the pass of the scan
+ *  @param   taken The time through the list within the pass
+ *  @return  The result of the conversion
+ */
+
+static uint16_t level (uint8_t channel, uint8_t pass, uint8_t taken)
+{
+	return (100 * channel + 17 * pass + 5 * taken + 1);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks that starting a scan sets up timer 0, the auto trigger and the 
+ *           multiplexer, keeping the reference the constructor chose.
+ */
+
+static void test_scan_setup (adc& a2d)
+{
+	a2d.start_scan (CHANNELS, CHANNEL_COUNT, 3);
+
+	CHECK_EQUAL (adc_channel (), CHANNELS[0]);
+	CHECK_EQUAL (ADMUX & ((1 << REFS1) | (1 << REFS0)), 1 << REFS0);
+	CHECK (ADCSRA & (1 << ADEN));
+	CHECK (ADCSRA & (1 << ADIE));
+	CHECK (ADCSRA & (1 << ADATE));
+	CHECK_EQUAL (TCCR0A, 1 << WGM01);
+	CHECK_EQUAL (TCCR0B, (1 << CS01) | (1 << CS00));
+	CHECK_EQUAL (OCR0A, F_CPU / 64 / ADC_TRIGGER_HZ - 1);
+	CHECK_EQUAL (ADCSRB & ((1 << ADTS2) | (1 << ADTS1) | (1 << ADTS0)), 
+				 (1 << ADTS1) | (1 << ADTS0));
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks the order in which the channels are converted and that each pass
+ *           averages only its own conversions of each channel.
+ *  @details Three conversions of each channel are averaged, so the averages are 
+ *           rounded down. No readings are given until the first pass is finished.
+ */
+
+static void test_scan_order_and_sums (adc& a2d)
+{
+	const uint8_t SAMPLES = 3;
+	uint16_t readings[CHANNEL_COUNT];
+
+	a2d.start_scan (CHANNELS, CHANNEL_COUNT, SAMPLES);
+	for (uint8_t pass = 0; pass < 4; pass++)
+	{
+		uint32_t sums[CHANNEL_COUNT] = { 0 };
+
+		for (uint8_t taken = 0; taken < SAMPLES; taken++)
+		{
+			for (uint8_t index = 0; index < CHANNEL_COUNT; index++)
+			{
+				uint8_t channel = CHANNELS[index];
+
+				CHECK_EQUAL (adc_channel (), channel);
+				CHECK_EQUAL (ADMUX & ((1 << REFS1) | (1 << REFS0)), 1 << REFS0);
+				sums[index] += level (channel, pass, taken);
+				adc_convert (level (channel, pass, taken));
+			}
+
+			// Until a pass is finished, the readings aren't touched
+			if (pass == 0 && taken < SAMPLES - 1)
+			{
+				memset (readings, 0xAA, sizeof (readings));
+				CHECK_EQUAL (a2d.get_scan (readings), 0);
+				CHECK_EQUAL (readings[0], 0xAAAA);
+			}
+		}
+
+		CHECK_EQUAL (a2d.get_scan (readings), pass + 1);
+		for (uint8_t index = 0; index < CHANNEL_COUNT; index++)
+		{
+			CHECK_EQUAL (readings[index], sums[index] / SAMPLES);
+		}
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks that the sums of the most conversions of full scale readings fit.
+ *  @details The number of conversions is clamped to @c ADC_SCAN_SAMPLES, and 64 
+ *           conversions of 1023 just fit in the 16-bit sums.
+ */
+
+static void test_scan_full_scale (adc& a2d)
+{
+	uint16_t readings[CHANNEL_COUNT];
+
+	a2d.start_scan (CHANNELS, CHANNEL_COUNT, 200);
+	for (uint16_t conversion = 0; conversion < ADC_SCAN_SAMPLES * CHANNEL_COUNT; 
+		 conversion++)
+	{
+		adc_convert (1023);
+	}
+	CHECK_EQUAL (a2d.get_scan (readings), 1);
+	for (uint8_t index = 0; index < CHANNEL_COUNT; index++)
+	{
+		CHECK_EQUAL (readings[index], 1023);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks that a request is converted between two of the scan's conversions
+ *           without disturbing the scan's sums, and that the scan then goes on with
+ *           the channel it would have converted next.
+ */
+
+static void test_request_during_scan (adc& a2d)
+{
+	const uint8_t SAMPLES = 2;
+	SemaphoreHandle_t done = xSemaphoreCreateBinary ();
+	uint16_t reading = 0;
+	uint16_t readings[CHANNEL_COUNT];
+
+	a2d.start_scan (CHANNELS, CHANNEL_COUNT, SAMPLES);
+	adc_convert (level (CHANNELS[0], 0, 0));
+
+	// The converter is busy with the scan, so the request waits for the ISR
+	CHECK (a2d.request (6, 2, &reading, done));
+	CHECK_EQUAL (adc_channel (), CHANNELS[1]);
+	adc_convert (level (CHANNELS[1], 0, 0));
+
+	CHECK_EQUAL (adc_channel (), 6);
+	adc_convert (600);
+	CHECK_EQUAL (adc_channel (), 6);
+	CHECK_EQUAL (*(uint16_t*)done, 0);
+	adc_convert (603);
+	CHECK_EQUAL (reading, 601);
+	CHECK_EQUAL (*(uint16_t*)done, 1);
+
+	// The scan goes on from the third channel in the list
+	for (uint8_t conversion = 2; conversion < SAMPLES * CHANNEL_COUNT; conversion++)
+	{
+		uint8_t index = conversion % CHANNEL_COUNT;
+
+		CHECK_EQUAL (adc_channel (), CHANNELS[index]);
+		adc_convert (level (CHANNELS[index], 0, conversion / CHANNEL_COUNT));
+	}
+	CHECK_EQUAL (a2d.get_scan (readings), 1);
+	for (uint8_t index = 0; index < CHANNEL_COUNT; index++)
+	{
+		CHECK_EQUAL (readings[index], (level (CHANNELS[index], 0, 0) 
+									   + level (CHANNELS[index], 0, 1)) / 2);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks that stopping the scan stops the auto trigger and the interrupt.
+ */
+
+static void test_stop_scan (adc& a2d)
+{
+	a2d.start_scan (CHANNELS, CHANNEL_COUNT, 1);
+	a2d.stop_scan ();
+	CHECK (!(ADCSRA & (1 << ADATE)));
+	CHECK (!(ADCSRA & (1 << ADIE)));
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Runs the A/D scan tests.
+ */
+
+int main (void)
+{
+	adc a2d;
+
+	test_scan_setup (a2d);
+	test_scan_order_and_sums (a2d);
+	test_scan_full_scale (a2d);
+	test_request_during_scan (a2d);
+	test_stop_scan (a2d);
+
+	return (host_report ("test_adc_scan"));
+}
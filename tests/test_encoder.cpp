@@ -0,0 +1,708 @@
+//======================================================================================
+/** @file test_encoder.cpp
+ *    This file contains host tests of the encoder driver. The driver's own ISRs from
+ *    \c encoder_driver.cpp are run against the stand-in pin register \c PINE and the
+ *    RTOS tick clock of \c time_model.h, and compared with the branch decoder the
+ *    driver used before. The tests are built once as they are and once with 
+ *    \c -DENCODER_BATCHED, in which the ISRs queue edges for \c drain() to decode.
+ *
+ *  Revisions:
+ *    @li 10-16-2026 Original file
+ *
+ *  License:
+ *    This file is copyright 2026 by its authors and released under the Lesser GNU
+ *    Public License, version 2, as the rest of this project is. It is intended for
+ *    educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//======================================================================================
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "encoder_driver.h"                 // The encoder driver under test
+#include "branch_decoder.h"                 // The decoder it replaced
+#include "time_model.h"                     // The clock it time stamps edges with
+#include "host.h"                           // Checks and stand-in registers
+
+// The ISRs which encoder_driver.cpp makes for the two encoders
+extern "C" void INT4_vect (void);
+extern "C" void INT6_vect (void);
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   This class opens up an encoder type's ISR state for the tests.
+ */
+
+template <class ENCODER>
+class probe : public ENCODER
+{
+	public:
+		using ENCODER::state;
+		using ENCODER::speed;
+		using ENCODER::decode;
+		using ENCODER::read_state;
+
+		/// Puts the encoder back as it was at power up, with channels as in PINE
+		static void reset (void)
+		{
+			memset (&state, 0, sizeof (state));
+			memset (&speed, 0, sizeof (speed));
+			state.state_old = read_state (PINE);
+			state.min_interval = ENCODER_MIN_EDGE_TICKS;
+			speed.window_stamp = encoder_time ();
+			#ifdef ENCODER_BATCHED
+				memset (&ENCODER::queue, 0, sizeof (ENCODER::queue));
+			#endif
+		}
+};
+
+typedef probe<GunEncoder> gun_probe;
+typedef probe<BaseEncoder> base_probe;
+
+/** @brief   This class stands in for a hardware counter clocked by the rising edges
+ *           of the base encoder's channel A, for use as the @c COUNTER of a 
+ *           @c CountedEncoder; @c move() counts the edges.
+ */
+
+class counter_model
+{
+	public:
+		/// The pin of PORTE which clocks the counter
+		static constexpr uint8_t CLOCK_PIN = PE6;
+
+		/// The number of rising edges counted, which rolls over at 65536
+		static uint16_t edges;
+
+		/// Starts the counter, which here is always counting
+		static void start (void) { }
+
+		/// Reads the number of rising edges counted
+		static uint16_t count (void) { return (edges); }
+};
+
+uint16_t counter_model::edges = 0;
+
+/** @brief   This class opens up an encoder counted by the model counter for the tests.
+ *           It shares its ISR state with the base encoder, whose ISR is 
+ *           \c INT6_vect.
+ */
+
+class counted_probe 
+	: public probe<CountedEncoder<encoder_port_e, PE6, PE7, INT6, counter_model> >
+{
+	public:
+		using CountedEncoder<encoder_port_e, PE6, PE7, INT6, counter_model>::counter;
+		using CountedEncoder<encoder_port_e, PE6, PE7, INT6, counter_model>
+			::enter_counter;
+};
+
+/// The two-bit channel states in the positive direction, channel A in bit 1
+static const uint8_t FORWARD[4] = { 0x00, 0x02, 0x03, 0x01 };
+
+//-------------------------------------------------------------------------------------
+/** @brief   Makes a pin register value with a two-bit channel state on two pins.
+ *  @param   others The pin register's other bits
+ *  @param   state The two-bit state, channel A in bit 1 and B in bit 0
+ *  @param   pin_a The pin number of channel A
+ *  @param   pin_b The pin number of channel B
+ *  @return  The pin register value
+ */
+
+static uint8_t make_pins (uint8_t others, uint8_t state, uint8_t pin_a, uint8_t pin_b)
+{
+	uint8_t pins = others & ~((1 << pin_a) | (1 << pin_b));
+
+	if (state & 0x02)
+	{
+		pins |= (1 << pin_a);
+	}
+	if (state & 0x01)
+	{
+		pins |= (1 << pin_b);
+	}
+	return (pins);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Runs an encoder's ISR, then decodes the edges queued in batched mode, as 
+ *           the task which drains the queues would. In direct mode the ISR has 
+ *           decoded the edge already and draining does nothing.
+ *  @param   isr The encoder's interrupt service routine
+ */
+
+static void run_isr (void (*isr)(void))
+{
+	isr ();
+	GunEncoder::drain ();
+	BaseEncoder::drain ();
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Moves an encoder one edge, as the hardware would see it.
+ *  @details Channel A's rising edges clock the model counter, and the ISR runs only
+ *           if the encoder's external interrupts are on.
+ *  @param   isr The encoder's interrupt service routine
+ *  @param   pin_a The pin number of channel A
+ *  @param   pin_b The pin number of channel B
+ *  @param   phase Reference to the encoder's phase, which is moved one step
+ *  @param   direction The direction of the step, +1 or -1
+ *  @param   ticks The time stamp ticks since the edge before
+ */
+
+static void move (void (*isr)(void), uint8_t pin_a, uint8_t pin_b, uint8_t& phase, 
+				  int8_t direction, uint16_t ticks)
+{
+	uint8_t was_high = PINE & (1 << pin_a);
+
+	phase = (phase + direction) & 3;
+	PINE = make_pins (PINE, FORWARD[phase], pin_a, pin_b);
+	time_advance (ticks);
+	if (!was_high && (PINE & (1 << pin_a)))
+	{
+		counter_model::edges++;
+	}
+	if (EIMSK & (1 << pin_a))
+	{
+		run_isr (isr);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks the table against the branch decoder for every pair of whole pin
+ *           register values, on both encoders' pins.
+ *  @details A legal step must move both the same way, and every transition the table
+ *           calls illegal must be an error to the branch decoder. The only difference
+ *           is deliberate: no change in the channels is an error to the branch decoder
+ *           but a glitch to the driver, which never looks it up as a step.
+ */
+
+static void test_table_matches_branch (void)
+{
+	uint32_t mismatches = 0;
+	uint32_t no_change = 0;
+
+	for (uint16_t old_pins = 0; old_pins < 256; old_pins++)
+	{
+		for (uint16_t pins = 0; pins < 256; pins++)
+		{
+			uint32_t gun_count = 0, gun_errors = 0, base_count = 0, base_errors = 0;
+
+			branch_decode (pins, old_pins, PE4, PE5, gun_count, gun_errors);
+			branch_decode (pins, old_pins, PE6, PE7, base_count, base_errors);
+
+			uint8_t gun_old = gun_probe::read_state (old_pins);
+			uint8_t gun_new = gun_probe::read_state (pins);
+			uint8_t base_old = base_probe::read_state (old_pins);
+			uint8_t base_new = base_probe::read_state (pins);
+			int8_t gun_delta = encoder_decode (gun_old, gun_new);
+			int8_t base_delta = encoder_decode (base_old, base_new);
+
+			if ((int32_t)gun_count != gun_delta || (gun_errors != 0) != (gun_delta == 0)
+				|| (int32_t)base_count != base_delta
+				|| (base_errors != 0) != (base_delta == 0))
+			{
+				mismatches++;
+			}
+			if (gun_old == gun_new)
+			{
+				no_change++;
+			}
+		}
+	}
+	CHECK_EQUAL (mismatches, 0);
+	CHECK_EQUAL (no_change, 256 * 64);
+
+	// The table itself: each step forward is +1, each step back -1, anything else 0
+	for (uint8_t old_state = 0; old_state < 4; old_state++)
+	{
+		for (uint8_t new_state = 0; new_state < 4; new_state++)
+		{
+			int8_t expected = 0;
+			for (uint8_t phase = 0; phase < 4; phase++)
+			{
+				if (FORWARD[phase] == old_state)
+				{
+					if (FORWARD[(phase + 1) & 3] == new_state)
+					{
+						expected = 1;
+					}
+					else if (FORWARD[(phase + 3) & 3] == new_state)
+					{
+						expected = -1;
+					}
+				}
+			}
+			CHECK_EQUAL (encoder_decode (old_state, new_state), expected);
+		}
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Runs an encoder's ISR and the branch decoder side by side over a random
+ *           walk with missed edges and interrupts with no change in the channels.
+ *  @details The edges are far enough apart that the glitch filter never drops one,
+ *           so the count must match the branch decoder's exactly, and each branch 
+ *           decoder error must be either an error or a glitch in the driver.
+ *  @param   isr The encoder's interrupt service routine
+ *  @param   p_state The encoder's ISR state block
+ *  @param   pin_a The pin number of channel A
+ *  @param   pin_b The pin number of channel B
+ */
+
+static void run_walk (void (*isr)(void), encoder_state_t* p_state, uint8_t pin_a, 
+					  uint8_t pin_b)
+{
+	uint32_t branch_count = 0;
+	uint32_t branch_errors = 0;
+	uint8_t phase = 0;
+	uint8_t old_pins = PINE;
+
+	srand (405);
+	for (uint16_t edge = 0; edge < 20000; edge++)
+	{
+		uint8_t choice = rand () % 20;
+		uint8_t others = PINE;
+
+		if (choice < 12)
+		{
+			phase = (phase + 1) & 3;
+		}
+		else if (choice < 17)
+		{
+			phase = (phase + 3) & 3;
+		}
+		else if (choice < 18)
+		{
+			phase = (phase + 2) & 3;
+		}
+		else if (choice < 19)
+		{
+			others ^= 0x0F;
+		}
+		PINE = make_pins (others, FORWARD[phase], pin_a, pin_b);
+		time_advance (100);
+
+		run_isr (isr);
+		branch_decode (PINE, old_pins, pin_a, pin_b, branch_count, branch_errors);
+		old_pins = PINE;
+	}
+	CHECK_EQUAL (p_state->count, (int32_t)branch_count);
+	CHECK_EQUAL (p_state->errors.count + p_state->errors.glitches, branch_errors);
+	CHECK (p_state->errors.count > 0);
+	CHECK (p_state->errors.glitches > 0);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks both encoders' ISRs against the branch decoder.
+ */
+
+static void test_isr_matches_branch (void)
+{
+	PINE = 0;
+	gun_probe::reset ();
+	run_walk (INT4_vect, &gun_probe::state, PE4, PE5);
+
+	PINE = 0;
+	base_probe::reset ();
+	run_walk (INT6_vect, &base_probe::state, PE6, PE7);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks that setting the count in the middle of a velocity window doesn't
+ *           show up as motion, for an encoder read by interrupts.
+ *  @details The encoder runs forward at 2500 counts per second while another task 
+ *           moves its count by a large amount between two velocity updates.
+ */
+
+static void test_set_count_keeps_velocity (void)
+{
+	uint8_t phase = 0;
+
+	PINE = 0;
+	EIMSK = 0xF0;
+	gun_probe::reset ();
+	for (uint8_t update = 0; update < 10; update++)
+	{
+		for (uint8_t edge = 0; edge < 25; edge++)
+		{
+			move (INT4_vect, PE4, PE5, phase, 1, 100);
+		}
+		if (update == 6)
+		{
+			GunEncoder::set_count (GunEncoder::view_count () + 100000L);
+		}
+		if (update == 7)
+		{
+			GunEncoder::set_count (-3);
+		}
+		GunEncoder::update_velocity ();
+		CHECK_NEAR (GunEncoder::velocity (), 2500, 25);
+	}
+	CHECK_EQUAL (GunEncoder::view_count (), -3 + 2 * 25);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks the same while a counter counts the encoder, which works out the
+ *           velocity from its own count.
+ *  @details The encoder runs forward at 25000 counts per second, fast enough that 
+ *           the counter stays on.
+ */
+
+static void test_counted_set_count_keeps_velocity (void)
+{
+	uint8_t phase = 0;
+
+	PINE = 0;
+	EIMSK = 0xF0;
+	counter_model::edges = 0;
+	memset (&counted_probe::counter, 0, sizeof (counted_probe::counter));
+	counted_probe::reset ();
+	for (uint16_t edge = 0; edge < 250; edge++)
+	{
+		move (INT6_vect, PE6, PE7, phase, 1, 10);
+	}
+	counted_probe::update_velocity ();
+	counted_probe::enter_counter (1);
+	CHECK (counted_probe::counter.active);
+
+	for (uint8_t update = 0; update < 10; update++)
+	{
+		for (uint16_t edge = 0; edge < 250; edge++)
+		{
+			move (INT6_vect, PE6, PE7, phase, 1, 10);
+		}
+		if (update == 4)
+		{
+			counted_probe::set_count (counted_probe::view_count () - 100000L);
+		}
+		counted_probe::update_velocity ();
+		CHECK (counted_probe::counter.active);
+		CHECK_NEAR (counted_probe::velocity (), 25000, 250);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks that an encoder with a counter prints the counter's count and 
+ *           state, not the count its interrupts stopped at.
+ */
+
+static void test_counted_printout (void)
+{
+	counted_probe encoder;
+	emstream serial;
+	uint8_t phase = 0;
+
+	memset (&counted_probe::counter, 0, sizeof (counted_probe::counter));
+	PINE = make_pins (0, FORWARD[phase], PE6, PE7);
+	counted_probe::reset ();
+	counted_probe::enter_counter (1);
+	for (uint16_t edge = 0; edge < 1000; edge++)
+	{
+		move (INT6_vect, PE6, PE7, phase, 1, 10);
+	}
+	CHECK_EQUAL (counted_probe::view_count (), 1000);
+	CHECK_EQUAL (counted_probe::state.count, 0);
+
+	serial << encoder;
+	CHECK (serial.text.find ("Count: 1000,") == 0);
+	CHECK (serial.text.find ("counter") != std::string::npos);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks that the time stamps go up by one for each count of the tick timer,
+ *           across RTOS ticks and when they roll over.
+ *  @details When the tick timer has cleared but its interrupt hasn't run yet, as in
+ *           an ISR which started just before, the tick count is one behind, and the
+ *           time must still come out right. If the timer was read just before it 
+ *           cleared, the tick count isn't behind.
+ */
+
+static void test_time_across_ticks (void)
+{
+	bool smooth = true;
+
+	time_set (0);
+	uint16_t before = encoder_time ();
+	for (uint32_t step = 0; step < 70000L; step++)
+	{
+		time_advance (1);
+		uint16_t now = encoder_time ();
+		smooth = smooth && (uint16_t)(now - before) == 1;
+		before = now;
+	}
+	CHECK (smooth);
+
+	time_set (10 * ENCODER_TICK_COUNTS - 1);
+	before = encoder_time ();
+	ENCODER_TICK_TCNT = 1;
+	ENCODER_TICK_TIFR = (1 << ENCODER_TICK_FLAG);
+	CHECK_EQUAL ((uint16_t)(encoder_time () - before), 2);
+
+	time_set (10 * ENCODER_TICK_COUNTS - 1);
+	ENCODER_TICK_TIFR = (1 << ENCODER_TICK_FLAG);
+	CHECK_EQUAL (encoder_time (), 10 * ENCODER_TICK_COUNTS - 1);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Decodes a two-bit channel state on the gun encoder at a given time.
+ */
+
+static void feed (uint8_t state, uint16_t now)
+{
+	gun_probe::decode (make_pins (0, state, PE4, PE5), now);
+}
+
+/// The kinds of noise put into the synthetic waveforms
+enum noise_t
+{
+	NOISE_MIDDLE,                           ///< A spike well away from any real edge
+	NOISE_AFTER,                            ///< A spike just after a real edge
+	NOISE_ACROSS,                           ///< A spike across the next real edge
+	NOISE_BOUNCE                            ///< A real edge which bounces as it changes
+};
+
+//-------------------------------------------------------------------------------------
+/** @brief   Plays a noisy waveform into the gun encoder's decoder and checks that the
+ *           noise changes neither the count nor the error count.
+ *  @details The encoder moves one edge every 50 ticks, mostly forward with runs
+ *           backward, and every third edge has noise of the given kind on one 
+ *           channel or the other, from 1 to 3 ticks long.
+ *  @param   noise The kind of noise
+ *  @return  The number of spikes or bounces put in
+ */
+
+static uint16_t play_noise (noise_t noise)
+{
+	uint8_t phase = 0;
+	int32_t expected = 0;
+	uint16_t now = 1000;
+	uint16_t noisy = 0;
+
+	gun_probe::reset ();
+	gun_probe::state.state_old = FORWARD[0];
+	srand (507 + noise);
+	for (uint16_t edge = 0; edge < 3000; edge++)
+	{
+		int8_t step = (edge % 200 < 150) ? 1 : -1;
+		uint8_t width = 1 + rand () % 3;
+		uint8_t channel = 1 + rand () % 2;
+		bool noisy_edge = (edge % 3 == 0);
+
+		phase = (phase + step) & 3;
+		expected += step;
+
+		if (noisy_edge && noise == NOISE_BOUNCE)
+		{
+			// The edge's channel goes to the new state, back, and to it again
+			uint8_t before = FORWARD[(phase - step) & 3];
+			feed (FORWARD[phase], now);
+			feed (before, now + 1);
+			feed (FORWARD[phase], now + 1 + width);
+			noisy++;
+		}
+		else if (noisy_edge && noise == NOISE_ACROSS)
+		{
+			// A spike on the other channel starts 1 tick before the edge and ends 
+			// after it, so one reading has both the spike and the edge in it
+			uint8_t before = FORWARD[(phase - step) & 3];
+			uint8_t changed = before ^ FORWARD[phase];
+			uint8_t other = changed ^ 0x03;
+			feed (before ^ other, now - 1);
+			feed (before ^ other ^ changed, now);
+			feed (FORWARD[phase], now + width);
+			noisy++;
+		}
+		else
+		{
+			feed (FORWARD[phase], now);
+		}
+
+		if (noisy_edge && (noise == NOISE_MIDDLE || noise == NOISE_AFTER))
+		{
+			uint16_t start = now + ((noise == NOISE_MIDDLE) ? 20 + rand () % 10 : 2);
+			feed (FORWARD[phase] ^ channel, start);
+			feed (FORWARD[phase], start + width);
+			noisy++;
+		}
+		now += 50;
+	}
+	CHECK_EQUAL (gun_probe::state.count, expected);
+	CHECK_EQUAL (gun_probe::state.errors.count, 0);
+	return (noisy);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks that spikes and bounces are dropped as glitches, two for each, and
+ *           never cost a count or cause an error.
+ */
+
+static void test_noise_is_dropped (void)
+{
+	uint16_t spikes = play_noise (NOISE_MIDDLE);
+	CHECK_EQUAL (gun_probe::state.errors.glitches, 2 * spikes);
+
+	spikes = play_noise (NOISE_AFTER);
+	CHECK_EQUAL (gun_probe::state.errors.glitches, 2 * spikes);
+
+	spikes = play_noise (NOISE_ACROSS);
+	CHECK_EQUAL (gun_probe::state.errors.glitches, 2 * spikes);
+
+	spikes = play_noise (NOISE_BOUNCE);
+	CHECK_EQUAL (gun_probe::state.errors.glitches, 2 * spikes);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks that the position is interpolated between edges, also just after
+ *           the RTOS tick timer has cleared, before the tick interrupt has run.
+ *  @details Edges come every 100 time stamp ticks, so halfway to the next one the 
+ *           position is half a count past the last, and just before it the position
+ *           is still short of the next count. If the pending tick were missed, 
+ *           the time since the last edge would look like nearly a whole rollover and
+ *           the encoder would look stopped.
+ */
+
+static void test_interpolation_across_tick (void)
+{
+	uint16_t now = 100 * ENCODER_TICK_COUNTS - 20 - 16 * 100;
+	uint8_t phase = 0;
+
+	PINE = 0;
+	time_set (now);
+	gun_probe::reset ();
+	for (uint8_t edge = 0; edge < 16; edge++)
+	{
+		now += 100;
+		phase = (phase + 1) & 3;
+		feed (FORWARD[phase], now);
+		if (edge % 4 == 3)
+		{
+			time_set (now);
+			GunEncoder::update_velocity ();
+		}
+	}
+	CHECK_EQUAL (GunEncoder::velocity (), ENCODER_TIMER_HZ / 100);
+
+	time_set (now + 50);
+	CHECK_EQUAL (GunEncoder::view_position (), 16 * ENCODER_ONE + ENCODER_ONE / 2);
+	time_set_pending (now + 50);
+	CHECK_EQUAL (GunEncoder::view_position (), 16 * ENCODER_ONE + ENCODER_ONE / 2);
+	time_set_pending (now + 99);
+	CHECK_EQUAL (GunEncoder::view_position (), 16 * ENCODER_ONE + ENCODER_ONE * 99 / 100);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks that the ISR drops a spike which comes just after the RTOS tick 
+ *           timer has cleared, before the tick interrupt has run.
+ *  @details The edge before the spike was stamped in the tick before, so the spike's
+ *           time stamp must carry the tick which the tick count doesn't have yet, or
+ *           the spike looks like it came a whole rollover later and is counted. The
+ *           spike's first edge is dropped and takes the edge before it back, two 
+ *           glitches, and its second edge counts that edge again.
+ */
+
+static void test_noise_across_tick (void)
+{
+	PINE = make_pins (0, FORWARD[0], PE4, PE5);
+	time_set (0);
+	gun_probe::reset ();
+	time_set (100 * ENCODER_TICK_COUNTS - 3);
+	PINE = make_pins (0, FORWARD[1], PE4, PE5);
+	run_isr (INT4_vect);
+	CHECK_EQUAL (gun_probe::state.count, 1);
+
+	time_set_pending (100 * ENCODER_TICK_COUNTS + 1);
+	PINE = make_pins (0, FORWARD[1] ^ 0x01, PE4, PE5);
+	run_isr (INT4_vect);
+	CHECK_EQUAL (gun_probe::state.count, 0);
+	CHECK_EQUAL (gun_probe::state.errors.glitches, 2);
+	time_set_pending (100 * ENCODER_TICK_COUNTS + 2);
+	PINE = make_pins (0, FORWARD[1], PE4, PE5);
+	run_isr (INT4_vect);
+
+	CHECK_EQUAL (gun_probe::state.count, 1);
+	CHECK_EQUAL (gun_probe::state.errors.glitches, 2);
+	CHECK_EQUAL (gun_probe::state.errors.count, 0);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks that spikes in the middle of periods don't disturb the velocity.
+ *  @details A spike against the direction of motion looks like a reversal until it
+ *           is taken back, so it mustn't cost the period ring.
+ */
+
+static void test_noise_keeps_velocity (void)
+{
+	uint8_t phase = 0;
+	uint16_t now = 0;
+
+	PINE = 0;
+	time_set (0);
+	gun_probe::reset ();
+	for (uint8_t update = 0; update < 8; update++)
+	{
+		for (uint8_t edge = 0; edge < 5; edge++)
+		{
+			now += 500;
+			phase = (phase + 1) & 3;
+			feed (FORWARD[phase], now);
+			feed (FORWARD[phase] ^ (1 + edge % 2), now + 240);
+			feed (FORWARD[phase], now + 241);
+		}
+		time_set (now + 10);
+		GunEncoder::update_velocity ();
+		if (update > 0)
+		{
+			CHECK_EQUAL (GunEncoder::velocity (), 500);
+		}
+	}
+	CHECK_EQUAL (gun_probe::state.count, 40);
+	CHECK_EQUAL (gun_probe::state.errors.count, 0);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Runs the encoder driver tests.
+ */
+
+int main (void)
+{
+	test_table_matches_branch ();
+	test_isr_matches_branch ();
+	test_set_count_keeps_velocity ();
+	test_time_across_ticks ();
+	test_counted_set_count_keeps_velocity ();
+	test_counted_printout ();
+	test_noise_is_dropped ();
+	test_noise_keeps_velocity ();
+	test_noise_across_tick ();
+	test_interpolation_across_tick ();
+
+	#ifdef ENCODER_BATCHED
+		return (host_report ("test_encoder_batched"));
+	#else
+		return (host_report ("test_encoder"));
+	#endif
+}
@@ -0,0 +1,357 @@
+//======================================================================================
+/** @file test_pid.cpp
+ *    This file contains host tests of the fixed point PID controller. It is run side
+ *    by side with the same control law in floating point, with gains and update 
+ *    period exactly as given rather than rounded, over long runs of changing errors
+ *    and rates with the settings @c task_control uses and some much stiffer ones. 
+ *    With only a proportional gain it's also compared with the floating point code 
+ *    @c task_control had before, and huge inputs are checked to saturate rather than
+ *    wrap around.
+ *
+ *  Revisions:
+ *    @li 10-16-2026 Original file
+ *
+ *  License:
+ *    This file is copyright 2026 by its authors and released under the Lesser GNU
+ *    Public License, version 2, as the rest of this project is. It is intended for
+ *    educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//======================================================================================
+
+#include <stdlib.h>
+
+#include "pid.h"                            // The controller under test
+#include "host.h"                           // Checks
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   This structure holds the settings a controller is made with.
+ */
+
+struct pid_settings_t
+{
+	double   kp;                            ///< Proportional gain
+	double   ki;                            ///< Integral gain per second
+	double   kd;                            ///< Derivative gain
+	uint16_t rate_hz;                       ///< Updates per second
+	int16_t  output_max;                    ///< The largest output
+	uint16_t d_filter_ms;                   ///< The derivative filter's time constant
+	int16_t  tolerance;                     ///< How far the outputs may differ
+};
+
+//-------------------------------------------------------------------------------------
+/** @brief   This class is the control law of class @c pid in floating point.
+ *  @details The rate filter's time constant is rounded to a power of two updates as
+ *           @c pid does it, since that's part of the law; nothing else is rounded.
+ */
+
+class float_law
+{
+	protected:
+		pid_settings_t settings;            ///< Gains, rate and limits
+		uint16_t filter_updates;            ///< The rate filter's time constant
+		double   integral;                  ///< The integral term
+		double   rate_filtered;             ///< The filtered rate
+		double   error_old;                 ///< The last error, in counts
+		bool     primed;                    ///< True once the filter has a rate
+
+		/// Returns the P and D terms for the last inputs with the present gains
+		double last_pd (void)
+		{
+			return (settings.kp * error_old - settings.kd * rate_filtered);
+		}
+
+		/// Limits a number to the largest output
+		double limit (double value)
+		{
+			if (value > settings.output_max)
+			{
+				return (settings.output_max);
+			}
+			if (value < -settings.output_max)
+			{
+				return (-settings.output_max);
+			}
+			return (value);
+		}
+
+	public:
+		/// The constructor makes a controller with an empty integral
+		float_law (const pid_settings_t& a_settings)
+			: settings (a_settings), integral (0.0), rate_filtered (0.0), 
+			  error_old (0.0), primed (false)
+		{
+			uint32_t updates = (uint32_t)settings.d_filter_ms * settings.rate_hz / 1000;
+			filter_updates = 1;
+			while (filter_updates < (1 << PID_D_SHIFT_MAX) 
+				   && 2UL * filter_updates <= updates)
+			{
+				filter_updates *= 2;
+			}
+		}
+
+		/// Changes the gains, moving the integral so the output doesn't jump
+		void set_gains (double a_kp, double a_ki, double a_kd)
+		{
+			double pd_before = last_pd ();
+			settings.kp = a_kp;
+			settings.ki = a_ki;
+			settings.kd = a_kd;
+			integral = limit (integral + pd_before - last_pd ());
+		}
+
+		/// Runs the controller once, as @c pid::update() does
+		int16_t update (int32_t error, int32_t rate, int16_t feed_forward)
+		{
+			if (!primed)
+			{
+				rate_filtered = rate;
+				primed = true;
+			}
+			rate_filtered += (rate - rate_filtered) / filter_updates;
+			error_old = (double)error / (1 << PID_ERROR_BITS);
+
+			double sum = last_pd () + feed_forward;
+			double step = settings.ki * error_old / settings.rate_hz;
+			double room = ((step > 0) ? settings.output_max : -settings.output_max) 
+						  - sum;
+			double stepped = integral + step;
+			if (step > 0 && stepped > room)
+			{
+				stepped = (integral > room) ? integral : room;
+			}
+			else if (step < 0 && stepped < room)
+			{
+				stepped = (integral < room) ? integral : room;
+			}
+			integral = limit (stepped);
+			return ((int16_t)limit ((int32_t)(sum + integral)));
+		}
+};
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Returns a random number from -range to range.
+ */
+
+static int32_t random_in (int32_t range)
+{
+	return ((int32_t)(rand () % (2 * range + 1)) - range);
+}
+
+//-------------------------------------------------------------------------------------
+/** @brief   Runs a fixed point controller and the floating point law side by side and
+ *           checks that their outputs stay within the settings' tolerance.
+ *  @details The error wanders around with its fraction bits, now and then jumps and
+ *           now and then is held for a long time, so the integral fills up, saturates
+ *           and unwinds. The command fed forward changes whenever the error jumps, 
+ *           and every so often both get new gains.
+ *  @param   settings The gains, rate and limits and the tolerance
+ */
+
+static void compare (const pid_settings_t& settings)
+{
+	pid fixed (PID_GAIN (settings.kp), PID_GAIN (settings.ki), PID_GAIN (settings.kd),
+			   settings.rate_hz, settings.output_max, settings.d_filter_ms);
+	float_law law (settings);
+	int32_t error = 0;
+	int32_t rate = 0;
+	int16_t feed_forward = 0;
+	int16_t worst = 0;
+
+	for (uint16_t update = 0; update < 20000; update++)
+	{
+		if (update % 1000 == 0)
+		{
+			error = random_in (400L << PID_ERROR_BITS);
+			feed_forward = random_in (settings.output_max / 2);
+		}
+		else if (update % 1000 < 700)
+		{
+			error += random_in (3L << PID_ERROR_BITS);
+		}
+		rate += random_in (200);
+		rate = (rate > 5000) ? 5000 : ((rate < -5000) ? -5000 : rate);
+
+		if (update % 5000 == 2500)
+		{
+			double scale = 0.5 + (update / 5000) * 0.15;
+			fixed.set_gains (PID_GAIN (settings.kp * scale), PID_GAIN (settings.ki 
+							 * scale), PID_GAIN (settings.kd * scale));
+			law.set_gains (settings.kp * scale, settings.ki * scale, 
+						   settings.kd * scale);
+		}
+
+		int16_t difference = abs (fixed.update (error, rate, feed_forward) 
+								  - law.update (error, rate, feed_forward));
+		worst = (difference > worst) ? difference : worst;
+	}
+	CHECK (worst <= settings.tolerance);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks the fixed point controller against the floating point law with
+ *           the gun and base settings of @c task_control, and with much stiffer and
+ *           much softer ones, at rates from 1 to 1000 updates a second.
+ *  @details The outputs can differ by the rounding of the gains, of the integral 
+ *           gain times the update period and of the error to a sixteenth of a count,
+ *           and where the sum is cut down to an integer; the stiffest gains make 
+ *           these worth one more count.
+ */
+
+static void test_matches_float_law (void)
+{
+	const pid_settings_t SETTINGS[] = 
+	{
+		{ 0.6, 1.0, 0.01, 100, 300, 40, 1 },
+		{ 1.0, 1.0, 0.01, 100, 300, 40, 1 },
+		{ 3.5, 3.9, 0.5, 250, 1000, 0, 2 },
+		{ 0.05, 0.2, 0.002, 50, 300, 200, 1 },
+		{ 0.6, 1.0, 0.01, 1000, 300, 40, 1 },
+		{ 0.6, 3.9, 0.01, 2, 300, 0, 1 },
+		{ 0.2, 3.9, 0.0, 1, 300, 0, 1 }
+	};
+
+	srand (421);
+	for (uint8_t index = 0; index < sizeof (SETTINGS) / sizeof (SETTINGS[0]); index++)
+	{
+		compare (SETTINGS[index]);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks that the integral grows at the integral gain times the error per 
+ *           second at any update rate.
+ *  @details At 2 updates a second the update period used to overflow 16 bits, and at
+ *           1000 it was rounded by 0.7%. A steady error of 10 counts for one second 
+ *           must fill the integral to 10, or 7.5 with a gain of 0.75.
+ */
+
+static void test_integral_at_any_rate (void)
+{
+	const uint16_t RATES[] = { 1, 2, 3, 7, 100, 999, 1000, 10000, 65535 };
+
+	for (uint8_t index = 0; index < sizeof (RATES) / sizeof (RATES[0]); index++)
+	{
+		pid one (0, PID_GAIN (1.0), 0, RATES[index], 300);
+		pid three_quarters (0, PID_GAIN (0.75), 0, RATES[index], 300);
+		int16_t output = 0;
+		int16_t part = 0;
+
+		for (uint16_t update = 0; update < RATES[index]; update++)
+		{
+			output = one.update (10L << PID_ERROR_BITS, 0);
+			part = three_quarters.update (-(10L << PID_ERROR_BITS), 0);
+		}
+
+		// The output is cut down toward zero, so a hair under 10 gives 9
+		CHECK (output == 10 || output == 9);
+		CHECK (part == -7);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks that with only a proportional gain the controller gives what the
+ *           floating point code in @c task_control did, @c error * KP limited to 300.
+ */
+
+static void test_matches_old_proportional (void)
+{
+	const double GAINS[] = { 0.6, 1.0 };
+
+	for (uint8_t index = 0; index < 2; index++)
+	{
+		pid fixed (PID_GAIN (GAINS[index]), 0, 0, 100, 300);
+		int16_t worst = 0;
+
+		for (int16_t error = -1000; error <= 1000; error++)
+		{
+			double old_out = error * GAINS[index];
+			int16_t speed_out = (old_out > 300) ? 300 
+								: ((old_out < -300) ? -300 : (int16_t)old_out);
+			int16_t difference = abs (fixed.update ((int32_t)error << PID_ERROR_BITS, 0) 
+									  - speed_out);
+			worst = (difference > worst) ? difference : worst;
+		}
+		CHECK (worst <= 1);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks that the integral doesn't wind up while the command fed forward 
+ *           holds the output at its limit.
+ *  @details When the feed-forward was added to the output after the controller, the
+ *           integral of a small steady error kept growing while the motor was at full
+ *           command, and the axis overshot once the profile slowed down. Here it 
+ *           mustn't grow toward the limit, so as soon as the feed-forward goes away 
+ *           the output is just the proportional term. The integral must still grow 
+ *           the other way, where the output isn't at its limit.
+ */
+
+static void test_feed_forward_windup (void)
+{
+	pid fixed (PID_GAIN (0.5), PID_GAIN (2.0), 0, 100, 300);
+	int16_t output = 0;
+
+	for (uint16_t update = 0; update < 500; update++)
+	{
+		output = fixed.update (20L << PID_ERROR_BITS, 0, 300);
+	}
+	CHECK_EQUAL (output, 300);
+	CHECK_EQUAL (fixed.update (20L << PID_ERROR_BITS, 0, 0), 10);
+
+	fixed.reset ();
+	for (uint16_t update = 0; update < 100; update++)
+	{
+		output = fixed.update (-(20L << PID_ERROR_BITS), 0, 300);
+	}
+	CHECK_NEAR (output, 300 - 10 - 40, 1);
+	CHECK_NEAR (fixed.update (-(20L << PID_ERROR_BITS), 0, 0), -10 - 40, 1);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks that errors and rates far too big for the products to hold give
+ *           the largest output the right way rather than wrapping around.
+ */
+
+static void test_saturates (void)
+{
+	pid fixed (PID_GAIN (3.9), PID_GAIN (3.9), PID_GAIN (3.9), 1000, 300);
+
+	CHECK_EQUAL (fixed.update (5000000L << PID_ERROR_BITS >> 2, 0), 300);
+	CHECK_EQUAL (fixed.update (-(5000000L << PID_ERROR_BITS >> 2), 0), -300);
+	CHECK_EQUAL (fixed.update (0, 100000000L), -300);
+	CHECK_EQUAL (fixed.update (0, -100000000L), 300);
+	CHECK_EQUAL (fixed.update (0x7FFFFFFFL, -0x7FFFFFFFL), 300);
+	CHECK_EQUAL (fixed.update (-0x7FFFFFFFL, 0x7FFFFFFFL), -300);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Runs the PID tests.
+ */
+
+int main (void)
+{
+	test_matches_float_law ();
+	test_integral_at_any_rate ();
+	test_matches_old_proportional ();
+	test_feed_forward_windup ();
+	test_saturates ();
+
+	return (host_report ("test_pid"));
+}
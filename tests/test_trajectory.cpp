@@ -0,0 +1,284 @@
+//======================================================================================
+/** @file test_trajectory.cpp
+ *    This file contains host tests of the trapezoidal motion profile. Moves are run
+ *    one update at a time with the settings @c task_control uses, and the profile's
+ *    planned time to arrival, its speed and acceleration through each phase of the
+ *    move, its answer to a new target in the middle of a move or behind it, and the
+ *    way it settles onto the target are checked against the limits it was given.
+ *
+ *  Revisions:
+ *    @li 10-16-2026 Original file
+ *
+ *  License:
+ *    This file is copyright 2026 by its authors and released under the Lesser GNU
+ *    Public License, version 2, as the rest of this project is. It is intended for
+ *    educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//======================================================================================
+
+#include <stdlib.h>
+
+#include "trajectory.h"                     // The profile under test
+#include "host.h"                           // Checks
+
+/// The speed limit, acceleration and update rate which task_control gives the gun
+#define TEST_SPEED  1500
+#define TEST_ACCEL  16000
+#define TEST_HZ     100
+
+/// How far the planned time to arrival may be from the real one, in updates
+#define TEST_ETA_UPDATES  3
+
+/// The most updates any move in these tests should take
+#define TEST_MAX_UPDATES  2000
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   This structure holds what was seen of a profile over a run of updates.
+ */
+
+struct run_t
+{
+	uint16_t updates;                       ///< Updates until arrival, or the limit
+	uint16_t eta_ms;                        ///< The time to arrival after the first
+	uint16_t cruise;                        ///< Updates spent at the speed limit
+	int16_t  top_speed;                     ///< The fastest speed either way
+	int32_t  top_accel;                     ///< The largest acceleration either way
+	uint8_t  phases;                        ///< Changes in the acceleration's sign
+	uint8_t  reversals;                     ///< Changes in the direction of motion
+	int32_t  last_step;                     ///< The last change in the setpoint
+};
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Runs a profile toward a target until it arrives.
+ *  @details The phases count how often the acceleration changes sign after the 
+ *           first update, from standing still to speeding up, cruising and slowing
+ *           down, so a plain trapezoid has three and a triangle two.
+ *  @param   profile The profile, which is left where the run stopped
+ *  @param   target The position to go to, in counts
+ *  @param   limit The most updates to run
+ *  @return  What was seen of the profile
+ */
+
+static run_t run (trajectory& profile, int32_t target, uint16_t limit)
+{
+	run_t seen = { 0, 0, 0, 0, 0, 0, 0, 0 };
+	int8_t sign_old = 0;
+	int16_t speed_old = profile.speed ();
+	int32_t setpoint_old = profile.update (target);
+
+	seen.eta_ms = profile.eta_ms ();
+	for (seen.updates = 1; seen.updates < limit && !profile.arrived (); seen.updates++)
+	{
+		int32_t setpoint = profile.update (target);
+		int16_t speed = profile.speed ();
+		int32_t accel = profile.acceleration ();
+		int8_t sign = (accel > 0) - (accel < 0);
+
+		if (abs (speed) > seen.top_speed)
+		{
+			seen.top_speed = abs (speed);
+		}
+		if (labs (accel) > seen.top_accel)
+		{
+			seen.top_accel = labs (accel);
+		}
+		if (abs (speed) == TEST_SPEED)
+		{
+			seen.cruise++;
+		}
+		if (sign != sign_old)
+		{
+			seen.phases++;
+			sign_old = sign;
+		}
+		if ((speed > 0 && speed_old < 0) || (speed < 0 && speed_old > 0))
+		{
+			seen.reversals++;
+		}
+		seen.last_step = setpoint - setpoint_old;
+		speed_old = (speed != 0) ? speed : speed_old;
+		setpoint_old = setpoint;
+	}
+	return (seen);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks the planned time to arrival against the real one, for moves long
+ *           enough to reach the speed limit and too short to, both ways.
+ */
+
+static void test_eta (void)
+{
+	const int32_t MOVES[] = { 1, 5, 50, 140, 141, 500, 1000, 20000, -30, -1000 };
+
+	for (uint8_t index = 0; index < sizeof (MOVES) / sizeof (MOVES[0]); index++)
+	{
+		trajectory profile (TEST_SPEED, TEST_ACCEL, TEST_HZ);
+		run_t seen = run (profile, MOVES[index], TEST_MAX_UPDATES);
+
+		CHECK (profile.arrived ());
+		CHECK_NEAR (seen.eta_ms + 1000 / TEST_HZ, seen.updates * 1000 / TEST_HZ,
+					TEST_ETA_UPDATES * 1000 / TEST_HZ);
+		CHECK_EQUAL (profile.eta_ms (), 0);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks that a long move speeds up, cruises and slows down, within its
+ *           limits, and that a short one never reaches the speed limit.
+ *  @details A move of 1000 counts spends about 94 ms speeding up and as long again
+ *           slowing down, covering 70 counts each way, and cruises for the rest.
+ */
+
+static void test_phases (void)
+{
+	trajectory profile (TEST_SPEED, TEST_ACCEL, TEST_HZ);
+	run_t seen = run (profile, 1000, TEST_MAX_UPDATES);
+
+	CHECK_EQUAL (seen.top_speed, TEST_SPEED);
+	CHECK (seen.top_accel <= TEST_ACCEL);
+	CHECK (seen.top_accel > TEST_ACCEL * 9 / 10);
+	CHECK_NEAR (seen.cruise, (1000 - 140) * TEST_HZ / TEST_SPEED, 2);
+	CHECK_EQUAL (seen.phases, 3);
+	CHECK_EQUAL (seen.reversals, 0);
+
+	// Forty counts is too short to reach the speed limit, so there's no cruise
+	profile.start (0);
+	seen = run (profile, 40, TEST_MAX_UPDATES);
+	CHECK (seen.top_speed < TEST_SPEED);
+	CHECK (seen.top_accel <= TEST_ACCEL);
+	CHECK_EQUAL (seen.cruise, 0);
+	CHECK_EQUAL (seen.reversals, 0);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks that a new target in the middle of a move is planned for and
+ *           reached without going past it or stopping on the way.
+ *  @details A target farther on only makes the cruise longer. A target just ahead,
+ *           too close to stop for, is gone past and come back to, without ever
+ *           slowing down faster than the limit.
+ */
+
+static void test_retarget (void)
+{
+	trajectory profile (TEST_SPEED, TEST_ACCEL, TEST_HZ);
+
+	run (profile, 1000, 30);
+	CHECK (!profile.arrived ());
+	run_t seen = run (profile, 2000, TEST_MAX_UPDATES);
+	CHECK (profile.arrived ());
+	CHECK_NEAR (seen.eta_ms + 1000 / TEST_HZ, seen.updates * 1000 / TEST_HZ,
+				TEST_ETA_UPDATES * 1000 / TEST_HZ);
+	CHECK_EQUAL (seen.reversals, 0);
+	CHECK (seen.top_accel <= TEST_ACCEL);
+	CHECK_EQUAL (profile.update (2000), (int32_t)2000 << TRAJECTORY_BITS);
+
+	profile.start (0);
+	run (profile, 1000, 30);
+	int32_t here = profile.update (1000) >> TRAJECTORY_BITS;
+	seen = run (profile, here + 20, TEST_MAX_UPDATES);
+	CHECK (profile.arrived ());
+	CHECK_EQUAL (seen.reversals, 1);
+	CHECK (seen.top_accel <= TEST_ACCEL);
+	CHECK_NEAR (seen.eta_ms + 1000 / TEST_HZ, seen.updates * 1000 / TEST_HZ,
+				TEST_ETA_UPDATES * 1000 / TEST_HZ);
+	CHECK_EQUAL (profile.update (here + 20), (here + 20) << TRAJECTORY_BITS);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks that a target behind a moving setpoint makes it slow down at the
+ *           limit, turn around once and go back, and that the plan counts the time
+ *           to stop.
+ */
+
+static void test_reversal (void)
+{
+	trajectory profile (TEST_SPEED, TEST_ACCEL, TEST_HZ);
+
+	run (profile, 1000, 30);
+	CHECK_EQUAL (profile.speed (), TEST_SPEED);
+	run_t seen = run (profile, -1000, TEST_MAX_UPDATES);
+	CHECK (profile.arrived ());
+	CHECK_EQUAL (seen.reversals, 1);
+	CHECK_EQUAL (seen.top_speed, TEST_SPEED);
+	CHECK (seen.top_accel <= TEST_ACCEL);
+	CHECK_NEAR (seen.eta_ms + 1000 / TEST_HZ, seen.updates * 1000 / TEST_HZ,
+				TEST_ETA_UPDATES * 1000 / TEST_HZ);
+	CHECK_EQUAL (profile.update (-1000), -((int32_t)1000 << TRAJECTORY_BITS));
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Checks that the setpoint is only said to have arrived when it stands
+ *           exactly on the target, and that it's put there from within one step.
+ *  @details The last step onto the target is no bigger than one update's change in
+ *           velocity, so it isn't a jump. Targets beyond @c TRAJECTORY_RANGE are
+ *           moved in to it rather than wrapping around.
+ */
+
+static void test_arrival (void)
+{
+	const int32_t STEP = ((int32_t)TEST_ACCEL << TRAJECTORY_BITS) / TEST_HZ / TEST_HZ;
+	trajectory profile (TEST_SPEED, TEST_ACCEL, TEST_HZ);
+
+	CHECK (profile.arrived ());
+	CHECK_EQUAL (profile.update (0), 0);
+	CHECK (profile.arrived ());
+
+	run_t seen = run (profile, 300, TEST_MAX_UPDATES);
+	CHECK (profile.arrived ());
+	CHECK (labs (seen.last_step) <= STEP);
+	CHECK_EQUAL (profile.speed (), 0);
+	CHECK_EQUAL (profile.update (300), (int32_t)300 << TRAJECTORY_BITS);
+	CHECK (profile.arrived ());
+
+	// Going past a target it couldn't stop for, the setpoint hasn't arrived
+	profile.start (0);
+	run (profile, 1000, 30);
+	int32_t here = profile.update (1000) >> TRAJECTORY_BITS;
+	for (uint16_t update = 0; update < 5; update++)
+	{
+		profile.update (here + 5);
+		CHECK (!profile.arrived ());
+	}
+
+	profile.start (40000L);
+	CHECK (profile.arrived ());
+	CHECK_EQUAL (profile.update (TRAJECTORY_RANGE),
+				 (int32_t)TRAJECTORY_RANGE << TRAJECTORY_BITS);
+	seen = run (profile, -40000L, 5000);
+	CHECK (profile.arrived ());
+	CHECK_EQUAL (profile.update (-TRAJECTORY_RANGE),
+				 -((int32_t)TRAJECTORY_RANGE << TRAJECTORY_BITS));
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Runs the motion profile tests.
+ */
+
+int main (void)
+{
+	test_eta ();
+	test_phases ();
+	test_retarget ();
+	test_reversal ();
+	test_arrival ();
+
+	return (host_report ("test_trajectory"));
+}
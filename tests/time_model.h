@@ -0,0 +1,82 @@
+//======================================================================================
+/** @file time_model.h
+ *    This file contains a model of the clock which the encoder driver time stamps 
+ *    edges with, for the host tests. The driver makes its time from the RTOS tick 
+ *    count and the tick timer's count, so a test sets both of them together, as 
+ *    they'd be if the tick timer had been running all along.
+ *
+ *  Revisions:
+ *    @li 10-16-2026 Original file
+ *
+ *  License:
+ *    This file is copyright 2026 by its authors and released under the Lesser GNU
+ *    Public License, version 2, as the rest of this project is. It is intended for
+ *    educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//======================================================================================
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _TIME_MODEL_H_
+#define _TIME_MODEL_H_
+
+#include "encoder_driver.h"                 // The clock which is modelled
+#include "host.h"                           // The stand-in tick count
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Sets the clock so that @c encoder_time() returns the given time.
+ *  @param   now The time, in @c ENCODER_TIMER_HZ ticks
+ */
+
+inline void time_set (uint16_t now)
+{
+	host_ticks = now / ENCODER_TICK_COUNTS;
+	ENCODER_TICK_TCNT = now % ENCODER_TICK_COUNTS;
+	ENCODER_TICK_TIFR = 0;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Sets the clock to a time just after the tick timer has cleared, with the
+ *           tick interrupt still waiting to run, as it is while another ISR runs.
+ *  @param   now The time, which must be in the first half of a tick
+ */
+
+inline void time_set_pending (uint16_t now)
+{
+	time_set (now);
+	host_ticks--;
+	ENCODER_TICK_TIFR = (1 << ENCODER_TICK_FLAG);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Moves the clock on, with a tick for each time the tick timer clears.
+ *  @details A tick interrupt which was waiting runs first.
+ *  @param   ticks The time to move on, in @c ENCODER_TIMER_HZ ticks
+ */
+
+inline void time_advance (uint16_t ticks)
+{
+	if (ENCODER_TICK_TIFR & (1 << ENCODER_TICK_FLAG))
+	{
+		host_ticks++;
+		ENCODER_TICK_TIFR = 0;
+	}
+
+	uint32_t count = (uint32_t)ENCODER_TICK_TCNT + ticks;
+
+	host_ticks += count / ENCODER_TICK_COUNTS;
+	ENCODER_TICK_TCNT = count % ENCODER_TICK_COUNTS;
+}
+
+#endif // _TIME_MODEL_H_
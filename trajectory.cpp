@@ -0,0 +1,241 @@
+//======================================================================================
+/** @file trajectory.cpp
+ *    This file contains a trapezoidal motion profile generator, which moves a setpoint
+ *    toward a target position with limited speed and acceleration.
+ *
+ *  Revisions:
+ *    @li 10-16-2026 Original file
+ *
+ *  License:
+ *    This file is copyright 2026 by its authors and released under the Lesser GNU
+ *    Public License, version 2, as the rest of this project is. It is intended for
+ *    educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//======================================================================================
+
+#include <stdlib.h>                         // Include standard library header files
+
+#include "trajectory.h"                     // Header for this profile generator
+#include "square_root.h"                    // Integer square root, for planning
+
+
+//-------------------------------------------------------------------------------------
+/** This function turns a position in counts into a setpoint, moving it in to 
+ *  @c TRAJECTORY_RANGE first if it's farther from zero.
+ *  @param   counts The position, in counts
+ *  @return  The position, in counts with @c TRAJECTORY_BITS fraction bits
+ */
+
+static int32_t to_setpoint (int32_t counts)
+{
+	if (counts > TRAJECTORY_RANGE)
+	{
+		counts = TRAJECTORY_RANGE;
+	}
+	else if (counts < -TRAJECTORY_RANGE)
+	{
+		counts = -TRAJECTORY_RANGE;
+	}
+	return (counts << TRAJECTORY_BITS);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This constructor makes a profile generator, standing still at position zero. The
+ *  limits are turned into steps per update here, with divisions, so @c update()
+ *  needs none except when the target changes.
+ *  @param   a_speed_limit The most speed in counts per second, up to 32767
+ *  @param   a_accel_limit The acceleration and deceleration in counts per second
+ *           squared
+ *  @param   a_rate_hz How many times a second @c update() is run, 25 or more
+ */
+
+trajectory::trajectory (uint16_t a_speed_limit, uint16_t a_accel_limit,
+						uint16_t a_rate_hz)
+{
+	speed_limit = a_speed_limit;
+	accel_limit = a_accel_limit;
+	rate_hz = a_rate_hz;
+	ms_per_update = ((1000UL << 8) + rate_hz / 2) / rate_hz;
+
+	speed_max = ((uint32_t)speed_limit << TRAJECTORY_BITS) / rate_hz;
+	accel = (((uint32_t)accel_limit << TRAJECTORY_BITS) / rate_hz) / rate_hz;
+	if (accel == 0)
+	{
+		accel = 1;
+	}
+
+	// Twice the acceleration gets enough fraction bits that its root has the root's
+	// number of them; the square root of a number halves its fraction bits
+	root_accel = square_root ((uint32_t)accel 
+							  << (2 * TRAJECTORY_ROOT_BITS - TRAJECTORY_BITS + 1));
+
+	start (0);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method puts the setpoint and the target at a position, standing still, as
+ *  when the motor is found to be somewhere at start-up.
+ *  @param   a_position The position, in counts, within @c TRAJECTORY_RANGE
+ */
+
+void trajectory::start (int32_t a_position)
+{
+	position = to_setpoint (a_position);
+	target = position;
+	velocity = 0;
+	velocity_old = 0;
+	eta = 0;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method works out how many updates it will take the setpoint to stop on the
+ *  target, from the continuous motion with the same limits. If the setpoint is moving
+ *  away from the target, it must stop first. If it's moving too fast to stop on the
+ *  target, it goes past and comes back; if it's too close to the target to reach 
+ *  full speed, the profile is a triangle whose peak speed is found with a square 
+ *  root, and otherwise it's a trapezoid with a cruise in the middle. Distances
+ *  are in whole counts and speeds in counts per second here, so the products fit.
+ *  @return  The number of updates, at most 65535
+ */
+
+uint16_t trajectory::plan (void)
+{
+	int32_t to_go = target - position;
+	uint32_t distance = labs (to_go) >> TRAJECTORY_BITS;
+	int32_t toward = (to_go < 0) ? -velocity : velocity;
+	int32_t speed = (toward * (int32_t)rate_hz) >> TRAJECTORY_BITS;
+	uint32_t updates = 0;
+
+	if (speed < 0)
+	{
+		speed = -speed;
+		updates = (uint32_t)speed * rate_hz / accel_limit;
+		distance += (uint32_t)speed * speed / (2UL * accel_limit);
+		speed = 0;
+	}
+
+	uint32_t peak_squared = (uint32_t)speed_limit * speed_limit;
+	uint32_t down = peak_squared / (2UL * accel_limit);
+	uint32_t up = (peak_squared - (uint32_t)speed * speed) / (2UL * accel_limit);
+	uint32_t stop = (uint32_t)speed * speed / (2UL * accel_limit);
+	if (stop >= distance)
+	{
+		// It goes past by the rest of its stopping distance, then comes back over
+		// that in a triangle from standing still
+		uint32_t peak = square_root ((uint32_t)accel_limit * (stop - distance));
+		updates += ((uint32_t)speed + 2UL * peak) * rate_hz / accel_limit;
+	}
+	else if (up + down <= distance)
+	{
+		updates += (2UL * speed_limit - speed) * rate_hz / accel_limit
+				   + (distance - up - down) * rate_hz / speed_limit;
+	}
+	else
+	{
+		uint32_t peak = square_root ((uint32_t)accel_limit * distance
+									 + (uint32_t)speed * speed / 2);
+		updates += (2UL * peak - speed) * rate_hz / accel_limit;
+	}
+
+	return ((updates > 0xFFFF) ? 0xFFFF : updates);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method runs the profile for one update. If the target has changed, the time
+ *  to arrival is planned again. The speed toward the target is then raised by a step,
+ *  but kept to the limit and to the speed from which the setpoint can stop in the 
+ *  distance left; it's never cut by more than a step, so if the target has jumped too
+ *  close to stop for, the setpoint goes past and comes back. Once the setpoint is 
+ *  within a step of the target and nearly still, it's put on the target.
+ *  @param   a_target The position to go to, in counts, within @c TRAJECTORY_RANGE
+ *  @return  The new setpoint, in counts with @c TRAJECTORY_BITS fraction bits
+ */
+
+int32_t trajectory::update (int32_t a_target)
+{
+	int32_t new_target = to_setpoint (a_target);
+
+	if (new_target != target)
+	{
+		target = new_target;
+		eta = plan ();
+	}
+
+	velocity_old = velocity;
+
+	int32_t to_go = target - position;
+	int32_t distance = labs (to_go);
+	int32_t speed = (to_go < 0) ? -velocity : velocity;
+
+	if (distance <= accel && labs (velocity) <= accel)
+	{
+		position = target;
+		velocity = 0;
+		eta = 0;
+		return (position);
+	}
+
+	// The speed here is toward the target, so it's negative when moving away. Moving
+	// a step at the stopping speed, less half a step of acceleration, then slowing a
+	// step at a time, ends up on the target
+	int32_t allowed = (((uint32_t)root_accel * square_root (distance)) 
+					   >> (TRAJECTORY_ROOT_BITS - TRAJECTORY_BITS / 2)) - accel / 2;
+	int32_t faster = speed + accel;
+	if (faster > speed_max)
+	{
+		faster = speed_max;
+	}
+	if (faster > allowed)
+	{
+		faster = allowed;
+	}
+	speed = (faster < speed - accel) ? speed - accel : faster;
+
+	velocity = (to_go < 0) ? -speed : speed;
+	position += velocity;
+	if (eta > 0)
+	{
+		eta--;
+	}
+	return (position);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method returns the velocity at which the setpoint moved in the last update.
+ *  @return  The velocity in counts per second, no more than the speed limit
+ */
+
+int16_t trajectory::speed (void)
+{
+	return ((velocity * (int32_t)rate_hz) >> TRAJECTORY_BITS);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method returns how much the setpoint's velocity changed in the last update. 
+ *  The change is less than a step of acceleration, so it's multiplied by the rate in
+ *  two halves to keep its fraction bits without overflowing.
+ *  @return  The acceleration in counts per second squared, within the limit
+ */
+
+int32_t trajectory::acceleration (void)
+{
+	int32_t change = (velocity - velocity_old) * (int32_t)rate_hz;
+
+	return (((change >> (TRAJECTORY_BITS / 2)) * (int32_t)rate_hz) 
+			>> (TRAJECTORY_BITS / 2));
+}
@@ -0,0 +1,111 @@
+//======================================================================================
+/** @file trajectory.h
+ *    This file contains the header for a trapezoidal motion profile generator. It
+ *    stands between a position setpoint which can jump and a controller which should
+ *    only be asked to follow what the motor can do, moving its own setpoint toward the
+ *    target with limited speed and acceleration, a little each update.
+ *
+ *  Revisions:
+ *    @li 10-16-2026 Original file
+ *
+ *  License:
+ *    This file is copyright 2026 by its authors and released under the Lesser GNU
+ *    Public License, version 2, as the rest of this project is. It is intended for
+ *    educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//======================================================================================
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _TRAJECTORY_H_
+#define _TRAJECTORY_H_
+
+#include <stdint.h>                         // Standard integer types
+
+/// The number of fraction bits in the profile's positions, speeds and accelerations
+#define TRAJECTORY_BITS  16
+
+/// The number of fraction bits in the square root of twice the acceleration
+#define TRAJECTORY_ROOT_BITS  12
+
+/** The farthest from zero, in counts, that a target or start position is taken to
+ *  be; positions beyond it are moved in to it. The setpoint is an @c int32_t with 
+ *  @c TRAJECTORY_BITS fraction bits, and this leaves it room to go past a target 
+ *  which it can't stop for. */
+#define TRAJECTORY_RANGE  30000
+
+//-------------------------------------------------------------------------------------
+/** @brief   This class moves a setpoint toward a target position in a trapezoidal
+ *           profile, accelerating, cruising and then slowing to a stop on the target.
+ *  @details Each call to @c update() changes the velocity by at most one update's
+ *           worth of acceleration and moves the setpoint by it. The speed toward the
+ *           target goes up until it reaches the limit, but never past the speed from 
+ *           which the setpoint can still stop on the target, which is the square root
+ *           of twice the acceleration times the distance left; so the setpoint slows
+ *           down just in time, whatever speed it had. Nothing about the move is 
+ *           planned ahead, so the target can change at any time, even in the middle 
+ *           of a move or to the other side, and the profile just bends toward it 
+ *           without a jump in speed. Positions and velocities are kept in counts and
+ *           counts per update with @c TRAJECTORY_BITS fraction bits, so slow 
+ *           accelerations at a thousand updates a second aren't rounded away; a move
+ *           must be shorter than 32768 counts.
+ *
+ *           The time to arrival is worked out, with a few divisions, only when the 
+ *           target changes; after that it's counted down one update at a time. The
+ *           setpoint's speed and acceleration are given too, so a controller can feed
+ *           them forward rather than wait for an error to build up.
+ */
+
+class trajectory
+{
+	protected:
+		int32_t  position;                  ///< The setpoint, in counts
+		int32_t  velocity;                  ///< The setpoint's velocity per update
+		int32_t  velocity_old;              ///< The velocity before the last update
+		int32_t  target;                    ///< Where the setpoint is going, in counts
+		int32_t  speed_max;                 ///< The most speed per update
+		int32_t  accel;                     ///< The change in velocity each update
+		uint16_t root_accel;                ///< The square root of twice accel
+		uint16_t speed_limit;               ///< The most speed in counts per second
+		uint16_t accel_limit;               ///< The acceleration in counts per second^2
+		uint16_t rate_hz;                   ///< The number of updates a second
+		uint16_t ms_per_update;             ///< Milliseconds per update, 8 fraction bits
+		uint16_t eta;                       ///< Updates left until arrival
+
+		// This method works out how many updates it will take to reach the target
+		uint16_t plan (void);
+
+	public:
+		// The constructor makes a profile with the given limits which is updated at
+		// the given rate
+		trajectory (uint16_t a_speed_limit, uint16_t a_accel_limit, uint16_t a_rate_hz);
+
+		// This method puts the setpoint and the target at a position, standing still
+		void start (int32_t a_position);
+
+		// This method moves the setpoint one update toward the target and returns it
+		int32_t update (int32_t a_target);
+
+		/// Returns true once the setpoint has stopped on the target
+		bool arrived (void) { return (position == target && velocity == 0); }
+
+		/// Returns the time left until the setpoint stops on the target, in ms
+		uint16_t eta_ms (void) { return (((uint32_t)eta * ms_per_update) >> 8); }
+
+		// This method returns the setpoint's velocity in counts per second
+		int16_t speed (void);
+
+		// This method returns the setpoint's last change in velocity, in counts per
+		// second squared
+		int32_t acceleration (void);
+};
+
+#endif // _TRAJECTORY_H_